@@ -0,0 +1,300 @@
+#include "render/render.hpp"
+#include "render/frame_sink.hpp"
+#include "controller/controller.hpp"
+#include "world/world.hpp"
+#include "clom.hpp"
+#include "user_settings.hpp"
+#include "profiler.hpp"
+
+#include <cstdio>
+#include <unistd.h>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <memory>
+
+/* Deterministic end-to-end benchmark: generates a world from a fixed seed,
+ * flies the camera along scripted paths, renders headlessly with a fixed
+ * delta time and writes frame time statistics per path as json. */
+
+user_settings U;
+
+namespace {
+
+struct bench_settings {
+    int frames_per_path;
+    float delta_time;
+    std::string output;
+    std::string trace;
+};
+
+/* A path places the player for frame t (0 to 1) and may modify the world. */
+struct bench_path {
+    std::string name;
+    std::function<void(float t, tc::Controller &controller, tc::World &world)> step;
+};
+
+struct path_result {
+    std::string name;
+    std::vector<float> frame_times; // in milliseconds
+};
+
+bench_settings process_command_line_options(int argc, char const *argv[]) {
+    CL_Option_Manager clom;
+
+    clom.register_flag("--help", "Display this help");
+    clom.register_setting<int>("seed", 0, "World generation seed");
+    clom.register_setting<int>("world-size", 8, "World x and z width in chunks");
+    clom.register_flag("--no-caves", "Disable cave generation");
+    clom.register_setting<int>("width", 160, "Viewport width");
+    clom.register_setting<int>("height", 48, "Viewport height");
+    clom.register_setting<std::string>("color-mode", "FULL", "FULL, COMPAT, ASCII, HALFBLOCK, HALFBLOCK_COMPAT or PALETTE256");
+    clom.register_setting<float>("render-distance", 100, "Render distance in blocks");
+    clom.register_setting<float>("fov", 70.0f, "Field of view in degrees");
+    clom.register_flag("--disable-textures", "Use flat colors instead of textures");
+    clom.register_setting<int>("frames", 240, "Frames rendered per camera path");
+    clom.register_setting<float>("delta-time", 1.0f / 24.0f, "Fixed simulation time step per frame in seconds");
+    clom.register_setting<std::string>("output", "termcraft_bench.json", "Json result file (- for stdout)");
+    clom.register_setting<std::string>("trace", "", "Write a Chrome/Perfetto trace of all pipeline stages to this file (empty: off)");
+
+    clom.generate_user_hint("termcraft_bench");
+    clom.process_cl_options(argc, argv);
+
+    if (clom.is_flag_set("--help")) {
+        clom.print_user_hint();
+        exit(0);
+    }
+
+    // everything not set here uses the same defaults as the game
+    U.cursor_visible = true;
+    U.world_size = clom.get_setting_value<int>("world-size");
+    U.seed = clom.get_setting_value<int>("seed");
+    U.no_caves = clom.is_flag_set("--no-caves");
+    U.fps = 24;
+    U.fov = clom.get_setting_value<float>("fov");
+    U.look_sensitivity = 90.0f;
+    U.noclip = true;
+    U.headless = true;
+    U.sink = sink_type::DISCARD;
+    U.frames = 0;
+    U.duration = 0.0f;
+    U.fixed_window_size = true;
+    U.width = clom.get_setting_value<int>("width");
+    U.height = clom.get_setting_value<int>("height");
+    U.color_mode = color_mode::from_name(clom.get_setting_value<std::string>("color-mode"));
+
+    U.color_tolerance = 0.0f;
+    U.dither = false;
+    U.disable_textures = clom.is_flag_set("--disable-textures");
+    U.sky_color = glm::vec3 {0x7c / 255.0f, 0xe1 / 255.0f, 0xff / 255.0f};
+    U.render_distance = clom.get_setting_value<float>("render-distance");
+    U.min_render_scale = 1.0f;
+    U.fog = 0.5f;
+    U.debug_info = false;
+    U.bad_normals = false;
+    U.hide_hud = false;
+    U.start_time = 10.0f;
+    U.time_scale = 60.0f;
+
+    bench_settings settings;
+    settings.frames_per_path = std::max(clom.get_setting_value<int>("frames"), 1);
+    settings.delta_time = clom.get_setting_value<float>("delta-time");
+    settings.output = clom.get_setting_value<std::string>("output");
+    settings.trace = clom.get_setting_value<std::string>("trace");
+
+    return settings;
+}
+
+// yaw and pitch (degrees) that look from one point to another
+glm::vec2 look_at(glm::vec3 from, glm::vec3 to) {
+    glm::vec3 d = to - from;
+    float yaw = glm::degrees(atan2(-d.x, d.z));
+    float pitch = glm::degrees(atan2(-d.y, glm::length(glm::vec2(d.x, d.z)))); // y points down
+    return {yaw, pitch};
+}
+
+std::vector<bench_path> create_paths(glm::vec3 spawn, float world_width, int seed) {
+    const float two_pi = 6.283185307f;
+    std::vector<bench_path> paths;
+
+    // circle around the spawn point, looking at it
+    paths.push_back({"spawn_orbit", [=](float t, tc::Controller &controller, tc::World &world) {
+        glm::vec3 pos = spawn + glm::vec3(cos(t * two_pi) * 20.0f, -12.0f, sin(t * two_pi) * 20.0f);
+        controller.teleport(pos, look_at(pos, spawn));
+    }});
+
+    // high above the ground diagonally across the world, looking ahead and down
+    paths.push_back({"high_altitude_flyover", [=](float t, tc::Controller &controller, tc::World &world) {
+        glm::vec3 pos = glm::mix(glm::vec3(0.1f * world_width, 40.0f, 0.1f * world_width),
+                                 glm::vec3(0.9f * world_width, 40.0f, 0.9f * world_width), t);
+        controller.teleport(pos, glm::vec2(-45.0f, -35.0f));
+    }});
+
+    // straight down from above the spawn into the ground (and its caves)
+    paths.push_back({"cave_dive", [=](float t, tc::Controller &controller, tc::World &world) {
+        glm::vec3 pos = spawn + glm::vec3(0.0f, glm::mix(-10.0f, 60.0f, t), 0.0f);
+        controller.teleport(pos, glm::vec2(t * 360.0f, -20.0f));
+    }});
+
+    // break and place blocks around the spawn every frame (remeshing)
+    auto gen = std::make_shared<std::mt19937>(seed);
+    paths.push_back({"block_edit_storm", [=](float t, tc::Controller &controller, tc::World &world) {
+        glm::vec3 pos = spawn + glm::vec3(0.0f, -3.0f, -8.0f);
+        controller.teleport(pos, look_at(pos, spawn));
+
+        std::uniform_int_distribution<int> offset_dis(-6, 6);
+        std::uniform_int_distribution<int> type_dis(0, 3);
+        const tc::block_type::Block_Type types[4] = {tc::block_type::EMPTY, tc::block_type::STONE,
+                                                    tc::block_type::OAK_LEAVES, tc::block_type::OAK_PLANKS};
+        for (int i = 0; i < 4; ++i) {
+            glm::ivec3 coord = glm::ivec3(spawn) + glm::ivec3(offset_dis(*gen), offset_dis(*gen) / 2, offset_dis(*gen));
+            world.replace(coord, types[type_dis(*gen)]);
+        }
+    }});
+
+    return paths;
+}
+
+float percentile(std::vector<float> sorted_values, float p) {
+    size_t index = std::min(sorted_values.size() - 1, static_cast<size_t>(p * (sorted_values.size() - 1) + 0.5f));
+    return sorted_values[index];
+}
+
+std::string result_json(const bench_settings &settings, const std::vector<path_result> &results) {
+    std::string json = "{\n";
+    char line[512];
+
+    snprintf(line, sizeof(line),
+             "  \"seed\": %d,\n  \"world_size\": %d,\n  \"width\": %d,\n  \"height\": %d,\n"
+             "  \"color_mode\": \"%s\",\n  \"render_distance\": %.1f,\n  \"frames_per_path\": %d,\n  \"delta_time\": %.6f,\n",
+             U.seed, U.world_size, U.width, U.height,
+             color_mode::names[U.color_mode], U.render_distance, settings.frames_per_path, settings.delta_time);
+    json.append(line);
+
+    json.append("  \"paths\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::vector<float> sorted = results[i].frame_times;
+        std::sort(sorted.begin(), sorted.end());
+        float sum = 0.0f;
+        for (float f : sorted) sum += f;
+
+        snprintf(line, sizeof(line),
+                 "    {\"name\": \"%s\", \"frames\": %zu, \"min_ms\": %.3f, \"median_ms\": %.3f, "
+                 "\"p95_ms\": %.3f, \"p99_ms\": %.3f, \"max_ms\": %.3f, \"mean_ms\": %.3f}%s\n",
+                 results[i].name.c_str(), sorted.size(), sorted.front(), percentile(sorted, 0.5f),
+                 percentile(sorted, 0.95f), percentile(sorted, 0.99f), sorted.back(), sum / sorted.size(),
+                 i + 1 < results.size() ? "," : "");
+        json.append(line);
+    }
+    json.append("  ]\n}\n");
+
+    return json;
+}
+
+} /* end of anonymous namespace */
+
+int main(int argc, char const *argv[]) {
+    bench_settings settings = process_command_line_options(argc, argv);
+
+    /* With the json on stdout, everything else that is printed (like the
+     * progress of World::generate) goes to stderr, stdout is only kept for the json. */
+    FILE *json_stream = nullptr;
+    if (settings.output == "-") {
+        const int stdout_copy = dup(STDOUT_FILENO);
+        json_stream = stdout_copy >= 0 ? fdopen(stdout_copy, "w") : nullptr;
+        if (!json_stream || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            fprintf(stderr, "Error: Failed to redirect stdout\n");
+            return 1;
+        }
+        setvbuf(stdout, nullptr, _IONBF, 0); // in order with the messages on stderr
+    }
+
+    if (!tc::block_type::load_block_textures()) {
+        fprintf(stderr, "Error: The built-in texture pack is invalid (rebuild)\n");
+        return 1;
+    }
+
+    if (!tc::profiler::start_trace(settings.trace)) {
+        fprintf(stderr, "Error: Failed to open the trace file %s\n", settings.trace.c_str());
+        return 1;
+    }
+
+    tc::World world {};
+    world.generate(U.seed, {U.world_size, U.world_size});
+
+    glm::ivec2 center = world.get_world_center();
+    glm::vec3 spawn {center.x + 0.5f, world.get_ground_height_at(center) - 0.5f, center.y + 0.5f};
+
+    tc::Controller controller {spawn,
+                               static_cast<float>(U.width) / static_cast<float>(U.height),
+                               10.0f,
+                               &world};
+    world.generate_initial_mesh();
+
+    tc::Render render {U.width, U.height};
+    render.set_sink(std::make_shared<tc::Null_Sink>());
+
+    // fly, so that gravity doesn't move the camera off the path
+    controller.input_event('x');
+    controller.simulation_step(settings.delta_time);
+
+    const float world_width = U.world_size * tc::chunk_size::width;
+    std::vector<bench_path> paths = create_paths(spawn, world_width, U.seed);
+    std::vector<path_result> results;
+
+    float global_time = 0.0f;
+
+    for (bench_path &path : paths) {
+        fprintf(stderr, "Running path %s...\n", path.name.c_str());
+
+        path_result result {path.name, {}};
+
+        for (int frame = 0; frame < settings.frames_per_path; ++frame) {
+            const float t = static_cast<float>(frame) / static_cast<float>(settings.frames_per_path);
+
+            auto timer_start = std::chrono::high_resolution_clock::now();
+
+            path.step(t, controller, world);
+            controller.simulation_step(settings.delta_time);
+
+            float time_of_day = U.start_time / 24.0f + global_time / 86400.0f * U.time_scale;
+            time_of_day -= floor(time_of_day);
+            render.set_params(U.width, U.height, global_time, time_of_day,
+                              controller.get_V_matrix(), controller.get_VP_matrix(),
+                              controller.get_active_block_type(), controller.is_flying(),
+                              controller.is_crouching(), controller.is_sprinting());
+            render.render(world.get_mesh());
+
+            auto timer_end = std::chrono::high_resolution_clock::now();
+            result.frame_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(timer_end - timer_start).count() / 1000.0f);
+
+            global_time += settings.delta_time;
+        }
+
+        results.push_back(result);
+    }
+
+    tc::profiler::end_trace();
+
+    std::string json = result_json(settings, results);
+
+    if (json_stream) {
+        fputs(json.c_str(), json_stream);
+        fclose(json_stream);
+    } else {
+        FILE *file = fopen(settings.output.c_str(), "w");
+        if (!file) {
+            fprintf(stderr, "Error: Failed to open %s\n", settings.output.c_str());
+            return 1;
+        }
+        fputs(json.c_str(), file);
+        fclose(file);
+        printf("%sWritten to %s\n", json.c_str(), settings.output.c_str());
+    }
+
+    return 0;
+}
@@ -60,6 +60,8 @@ void Controller::input_event(char key) {
 }
 
 void Controller::simulation_step(float delta_time) {
+    profiler::Scoped_Timer timer {"Controller::simulation_step"};
+
     old_looked_at_block = looked_at_block;
     old_pos = pos;
 
@@ -80,6 +82,16 @@ void Controller::update_aspect(float value) {
     camera.calc_VP_matrix();
 }
 
+void Controller::teleport(glm::vec3 p_pos, glm::vec2 look) {
+    // used for scripted camera paths (benchmark)
+    old_pos = pos;
+    velocity = glm::vec3(0.0f);
+    camera.yaw = look.x;
+    camera.pitch = std::clamp(look.y, -90.0f, 90.0f);
+
+    move(p_pos - pos);
+}
+
 void Controller::get_params(glm::vec3 *pos_ptr, glm::vec3 *velocity_ptr, glm::vec2 *look_ptr) {
     *pos_ptr = pos;
     *velocity_ptr = velocity;
@@ -9,6 +9,7 @@
 #include "../world/block.hpp"
 #include "../world/raycast_util.hpp"
 #include "../user_settings.hpp"
+#include "../profiler.hpp"
 
 #include <algorithm>
 #include <optional>
@@ -26,6 +27,7 @@ public:
     void input_event(char key);
     void simulation_step(float delta_time);
     void update_aspect(float value);
+    void teleport(glm::vec3 p_pos, glm::vec2 look);
     void get_params(glm::vec3 *pos_ptr, glm::vec3 *velocity_ptr, glm::vec2 *look_ptr);
     bool is_flying();
     bool is_crouching();
@@ -8,10 +8,11 @@ namespace tc {
 // public:
 
 Engine::Engine() {
-    system_catch_error("tput clear", 7);
+    if (!U.headless) catch_error(terminal.clear());
 
     update_window_size();
     render = Render {X_size, Y_size};
+    create_sink();
 
     world = World {};
     world.generate(U.seed, {U.world_size, U.world_size});
@@ -27,19 +28,26 @@ Engine::Engine() {
 }
 
 int Engine::run() {
-    if (!U.cursor_visible) system_catch_error("tput civis", 5);
-    system_catch_error("stty -echo cbreak", 6);
-    // system_catch_error("tput clear", 7);
+    if (U.headless) {
+        // no terminal setup and no input, just render until the frame or time limit
+        if (!process_should_stop) render_loop();
+        if (frame_count > 0) printf("Rendered %d frames in %.2fs (%.1f fps)\n", frame_count, global_time, frame_count / global_time);
+        return status;
+    }
+
+    if (!U.cursor_visible) catch_error(terminal.hide_cursor());
+    catch_error(terminal.setup_input());
 
     input_thread = thread(&Engine::input_loop, this);
     render_thread = thread(&Engine::render_loop, this);
 
     input_thread.join(); // wait until user quits
     render_thread.join(); // ensures clean exit
+    render.stop_output(); // no frame may be written after the terminal is restored
 
-    if (!U.cursor_visible) system_catch_error("tput cnorm", 8);
-    system_catch_error("stty echo -cbreak", 9);
-    system_catch_error("tput clear", 7);
+    if (!U.cursor_visible) catch_error(terminal.show_cursor());
+    catch_error(terminal.restore_input());
+    catch_error(terminal.clear());
 
     return status;
 }
@@ -66,22 +74,29 @@ void Engine::render_loop() {
         chrono::high_resolution_clock timer;
         auto timer_start = timer.now();
 
-        this_thread::sleep_for(chrono::microseconds(int(1000000.0f / corrected_fps)));
+        if (!U.headless) this_thread::sleep_for(chrono::microseconds(int(1000000.0f / corrected_fps)));
 
         update_window_size();
         controller.simulation_step(delta_time);
         render.set_params(X_size, Y_size, global_time, time_of_day, controller.get_V_matrix(), controller.get_VP_matrix(), controller.get_active_block_type(), controller.is_flying(), controller.is_crouching(), controller.is_sprinting());
         if (U.debug_info) render.set_debug_info(debug_info_string());
 
-        system_catch_error("tput cup 0 0", 4);
-        render.render(world.get_mesh());
+        /* Frames position the cursor themselves,
+         * so a failed write is reported as error 4. */
+        if (!render.render(world.get_mesh())) crash(4);
 
         auto timer_end = timer.now();
-        delta_time = chrono::duration_cast<chrono::milliseconds>(timer_end - timer_start).count() / 1000.0f;
+        delta_time = chrono::duration_cast<chrono::microseconds>(timer_end - timer_start).count() / 1000000.0f;
         global_time += delta_time;
+        ++frame_count;
         calc_time_of_day();
         fps = 1.0f / delta_time;
         corrected_fps += static_cast<float>(U.fps) - fps;
+
+        if (U.headless && ((U.frames > 0 && frame_count >= U.frames) ||
+                           (U.duration > 0.0f && global_time >= U.duration))) {
+            process_should_stop = true;
+        }
     }
 }
 
@@ -90,6 +105,18 @@ string Engine::debug_info_string() {
     int n_active_tris;
     render.get_params(&n_tris, &n_active_tris);
 
+    size_t frame_bytes;
+    float encode_time;
+    int n_dropped;
+    render.get_output_stats(&frame_bytes, &encode_time, &n_dropped);
+
+    float render_scale;
+    int X_res, Y_res;
+    render.get_render_scale(&render_scale, &X_res, &Y_res);
+
+    int n_sections, n_visible_sections, n_occluded_sections;
+    render.get_culling_stats(&n_sections, &n_visible_sections, &n_occluded_sections);
+
     int time_of_day_hours = (int)floor(time_of_day * 24);
 
     glm::vec3 pos;
@@ -106,6 +133,7 @@ string Engine::debug_info_string() {
     ss << std::fixed << std::setprecision(2);
     ss << "fps: " << static_cast<int>(fps) << " / " << U.fps << "\n";
     ss << "screen: " << X_size << "x" << Y_size << "\n";
+    ss << "render scale: " << static_cast<int>(render_scale * 100.0f + 0.5f) << "% (" << X_res << "x" << Y_res << ")\n";
     ss << "running time: " << global_time << "s\n";
     ss << "in-game time: "  << setfill('0') << setw(2) << time_of_day_hours << ":"
        << setw(2) << (int)floor((time_of_day*24.0f - time_of_day_hours) * 60) << "\n";
@@ -115,13 +143,20 @@ string Engine::debug_info_string() {
     ss << "pitch: " << look.y << " deg\n";
     ss << "tris: " << n_tris << "\n";
     ss << "active tris: " << n_active_tris << "\n";
+    ss << "sections in view: " << n_visible_sections << " / " << n_sections << "\n";
+    ss << "occluded sections: " << n_occluded_sections << "\n";
+    ss << "vertex transform: " << vertex_transform_isa() << "\n";
     ss << "est. memory: " << est_memory << "MB\n";
+    ss << "output: " << frame_bytes << " bytes/frame\n";
+    ss << "encode time: " << encode_time << "ms\n";
+    ss << "dropped frames: " << n_dropped << "\n";
+    ss << profiler::stats_string();
 
     return ss.str();
 }
 
 void Engine::update_window_size() {
-    if (U.fixed_window_size) {
+    if (U.fixed_window_size || U.headless) {
         X_size = U.width;
         Y_size = U.height;
     }
@@ -129,31 +164,55 @@ void Engine::update_window_size() {
         old_X_size = X_size;
         old_Y_size = Y_size;
 
-        FILE *file;
-        if (!(file = popen("tput cols; tput lines", "r"))) {
-            crash(2);
-        }
+        // only ask the terminal after it reported a resize (SIGWINCH)
+        if (!terminal.size_changed()) return;
 
-        if(fscanf(file, "%d %d", &X_size, &Y_size) != 2) { // ie. failed to read 2 numbers
-            crash(10);
+        int result = terminal.get_size(&X_size, &Y_size);
+        if (result) {
+            crash(result);
+            return;
         }
 
-        pclose(file);
-
         if (X_size != old_X_size || Y_size != old_Y_size) {
             controller.update_aspect(static_cast<float>(X_size) / static_cast<float>(Y_size));
         }
     }
 }
 
+void Engine::create_sink() {
+    if (!U.headless) {
+        render.set_sink(make_shared<FD_Sink>(STDOUT_FILENO));
+        return;
+    }
+
+    switch (U.sink) {
+        case sink_type::DISCARD:
+            render.set_sink(make_shared<Null_Sink>());
+            break;
+        case sink_type::PPM:
+            render.set_sink(make_shared<PPM_Sink>(U.output));
+            break;
+        case sink_type::ANSI: {
+            int fd = open(U.output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                render.set_sink(make_shared<Null_Sink>());
+                crash(11);
+            } else {
+                render.set_sink(make_shared<FD_Sink>(fd, true));
+            }
+            break;
+        }
+    }
+}
+
 void Engine::calc_time_of_day() {
     const float seconds_per_day = 86400.0f;
     time_of_day = global_time / seconds_per_day * U.time_scale + U.start_time / 24.0f;
     time_of_day -= floor(time_of_day);
 }
 
-void Engine::system_catch_error(string command, int code) {
-    if (system(command.c_str())) {
+void Engine::catch_error(int code) {
+    if (code) {
         crash(code);
     }
 }
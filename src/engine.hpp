@@ -5,6 +5,8 @@
 #include "controller/controller.hpp"
 #include "world/world.hpp"
 #include "user_settings.hpp"
+#include "terminal.hpp"
+#include "profiler.hpp"
 
 #include <cstdlib>
 #include <chrono>
@@ -15,6 +17,9 @@
 #include <iomanip>
 #include <string>
 #include <cmath>
+#include <memory>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace tc {
 
@@ -30,10 +35,12 @@ private:
 
     std::string debug_info_string();
     void update_window_size();
+    void create_sink();
     void calc_time_of_day();
-    void system_catch_error(std::string command, int code);
+    void catch_error(int code);
     void crash(int code);
 
+    Terminal terminal;
     Render render;
     World world;
     Controller controller;
@@ -46,6 +53,7 @@ private:
     float delta_time = 0.0f;
     float global_time = 0.0f;
     float time_of_day = 0.0f;
+    int frame_count = 0;
 
     std::thread input_thread;
     std::thread render_thread;
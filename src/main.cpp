@@ -1,6 +1,7 @@
 #include "engine.hpp"
 #include "clom.hpp"
 #include "user_settings.hpp"
+#include "profiler.hpp"
 
 #include <cstdio>
 
@@ -12,17 +13,27 @@ void process_command_line_options(int argc, char const *argv[]) {
     clom.register_flag("--help", "Display this help");
     clom.register_flag("--cursor-visible", "Make the cursor not hidden (compat)");
     clom.register_setting<int>("fps", 24, "Target fps");
+    clom.register_flag("--headless", "Render without a terminal at the fixed width and height (see sink, output, frames, duration)");
+    clom.register_setting<std::string>("sink", "NULL", "Where --headless frames go\nNULL: discard (frames are still encoded)\nPPM: raw rgb images <output>_000001.ppm, ...\nANSI: the ansi byte stream into the file <output>");
+    clom.register_setting<std::string>("output", "termcraft_out", "Output file (ANSI sink) or file name prefix (PPM sink)");
+    clom.register_setting<int>("frames", 0, "Exit after this many frames in --headless mode (0 = no limit)");
+    clom.register_setting<float>("duration", 0.0f, "Exit after this many seconds in --headless mode (0 = no limit)");
     clom.register_flag("--fixed-window-size", "Enable the width and height settings (if not set: automatic window size)");
     clom.register_setting<int>("width", 80, "Window width (if --fixed-window-size is set)");
     clom.register_setting<int>("height", 24, "Window height (if --fixed-window-size is set)");
-    clom.register_setting<std::string>("color-mode", "FULL", "FULL: rgb color\nCOMPAT: bw color (if FULL is not supported)\nASCII: bw as ascii art (for fun)");
+    clom.register_setting<std::string>("color-mode", "FULL", "FULL: rgb color\nCOMPAT: bw color (if FULL is not supported)\nASCII: bw as ascii art (for fun)\nHALFBLOCK: rgb color, two pixels per cell (double vertical resolution)\nHALFBLOCK_COMPAT: bw color, two pixels per cell\nPALETTE256: 256 color palette (less output than FULL)");
+    clom.register_setting<float>("color-tolerance", 0.0f, "Perceptual color difference (0 to ~765) below which a cell is not redrawn (reduces output on slow connections)");
+    clom.register_flag("--dither", "Use ordered dithering in PALETTE256 color mode");
     clom.register_setting<std::string>("sky-color", "0x7ce1ff", "Hex code of sky color (it says std::string, but is actually hexadecimal int, eg. 0x7ce1ff)");
     clom.register_setting<float>("render-distance", 100, "Render distance in blocks");
+    clom.register_setting<float>("min-render-scale", 0.33f, "Lowest internal render resolution (fraction of the window) used to keep the target fps (1 = off)");
     clom.register_setting<float>("fog", 0.5f, "Fog factor (0.0 to 1.0)");
     clom.register_flag("--debug-info", "Show debug info in the HUD");
+    clom.register_setting<std::string>("trace", "", "Write a Chrome/Perfetto trace of all pipeline stages to this file (empty: off)");
     clom.register_flag("--bad-normals", "Show face front in blue, back in red; Disable backface culling");
     clom.register_setting<float>("fov", 70.0f, "Field of view in degrees");
     clom.register_flag("--disable-textures", "Use flat colors instead of textures");
+    clom.register_setting<std::string>("texture-dir", "", "Load the textures from png files under this directory (res/tex/*.png) instead of the built-in texture pack, for modding (empty: built-in)");
     clom.register_setting<int>("world-size", 10, "World x and z width in chunks");
     clom.register_setting<float>("start-time", 10.0f, "Starting time of day (in 24-hour clock)");
     clom.register_setting<float>("time-scale", 60.0f, "Speed up factor of time of day (1 = real life scale; 60 (default) = 24 in game hours hours last 24 real life minutes)");
@@ -42,10 +53,24 @@ void process_command_line_options(int argc, char const *argv[]) {
 
     U.cursor_visible = clom.is_flag_set("--cursor-visible");
     U.fps = clom.get_setting_value<int>("fps");
+    U.headless = clom.is_flag_set("--headless");
+
+    std::string sink_name = clom.get_setting_value<std::string>("sink");
+    if (sink_name == "PPM") U.sink = sink_type::PPM;
+    else if (sink_name == "ANSI") U.sink = sink_type::ANSI;
+    else U.sink = sink_type::DISCARD;
+
+    U.output = clom.get_setting_value<std::string>("output");
+    U.frames = clom.get_setting_value<int>("frames");
+    U.duration = clom.get_setting_value<float>("duration");
     U.fixed_window_size = clom.is_flag_set("--fixed-window-size");
     U.width = clom.get_setting_value<int>("width");
     U.height = clom.get_setting_value<int>("height");
-    U.color_mode = clom.get_setting_value<std::string>("color-mode");
+
+    U.color_mode = color_mode::from_name(clom.get_setting_value<std::string>("color-mode"));
+
+    U.color_tolerance = clom.get_setting_value<float>("color-tolerance");
+    U.dither = clom.is_flag_set("--dither");
 
     unsigned int col = std::stoi(clom.get_setting_value<std::string>("sky-color"), nullptr, 16);
     unsigned int r = (col >> 16) & 0xff;
@@ -54,11 +79,14 @@ void process_command_line_options(int argc, char const *argv[]) {
     U.sky_color = glm::vec3 {(float)r/255.0f, (float)g/255.0f, (float)b/255.0f};
 
     U.render_distance = clom.get_setting_value<float>("render-distance");
+    U.min_render_scale = clom.get_setting_value<float>("min-render-scale");
     U.fog = clom.get_setting_value<float>("fog");
     U.debug_info = clom.is_flag_set("--debug-info");
+    U.trace = clom.get_setting_value<std::string>("trace");
     U.bad_normals = clom.is_flag_set("--bad-normals");
     U.fov = clom.get_setting_value<float>("fov");
     U.disable_textures = clom.is_flag_set("--disable-textures");
+    U.texture_dir = clom.get_setting_value<std::string>("texture-dir");
     U.world_size = clom.get_setting_value<int>("world-size");
     U.start_time = clom.get_setting_value<float>("start-time");
     U.time_scale = clom.get_setting_value<float>("time-scale");
@@ -71,14 +99,15 @@ void process_command_line_options(int argc, char const *argv[]) {
 
 void print_error_message(int result) {
     switch (result) {
-        case  2: printf("Error: Failed to get terminal size and/or open pipe with `popen(\"tput cols; tput lines\", \"r\"))`. You might need to use the flag `--fixed-window-size`.\n"); break;
-        case  4: printf("Error: Failed to set cursor to position zero (command: `tput cup 0 0`).\n"); break;
-        case  5: printf("Error: Failed to make cursor invisible (command: `tput civis`). You might need to use the flag `--cursor-visible`.\n"); break;
-        case  6: printf("Error: Input setup failed (command: `stty -echo cbreak`).\n"); break;
-        case  7: printf("Error: Failed to clear the terminal window (command: `tput clear`).\n"); break;
-        case  8: printf("Error: Failed to reset cursor to normal mode (command: `tput cnorm`). You might need to use the flag `--cursor-visible`.\n"); break;
-        case  9: printf("Error: Failed to reset input to normal mode (command: `stty echo -cbreak`).\n"); break;
-        case 10: printf("Error: Failed to read terminal size from pipe with `fscanf(...)`. You might need to use the flag `--fixed-window-size`.\n"); break;
+        case  2: printf("Error: Failed to get terminal size (`ioctl(TIOCGWINSZ)` or `sigaction(SIGWINCH)` failed). You might need to use the flag `--fixed-window-size`.\n"); break;
+        case  4: printf("Error: Failed to write a frame to the terminal or the --headless sink.\n"); break;
+        case  5: printf("Error: Failed to make cursor invisible (escape: `\\e[?25l`). You might need to use the flag `--cursor-visible`.\n"); break;
+        case  6: printf("Error: Input setup failed (`tcsetattr`, equivalent of `stty -echo cbreak`).\n"); break;
+        case  7: printf("Error: Failed to clear the terminal window (escape: `\\e[2J`).\n"); break;
+        case  8: printf("Error: Failed to reset cursor to normal mode (escape: `\\e[?25h`). You might need to use the flag `--cursor-visible`.\n"); break;
+        case  9: printf("Error: Failed to reset input to normal mode (`tcsetattr`, equivalent of `stty echo -cbreak`).\n"); break;
+        case 10: printf("Error: The terminal reported a size of zero. You might need to use the flag `--fixed-window-size`.\n"); break;
+        case 11: printf("Error: Failed to open the output file of the ANSI sink (setting `output`).\n"); break;
     }
 }
 
@@ -86,8 +115,19 @@ int main(int argc, char const *argv[]) {
 
     process_command_line_options(argc, argv);
 
+    if (!tc::block_type::load_block_textures()) {
+        printf("Error: The built-in texture pack is invalid (rebuild, or load png files with the setting texture-dir)\n");
+        return 1;
+    }
+
+    if (!tc::profiler::start_trace(U.trace)) {
+        printf("Error: Failed to open the trace file %s\n", U.trace.c_str());
+        return 1;
+    }
+
     tc::Engine engine {};
     int result = engine.run();
+    tc::profiler::end_trace();
     printf("Engine exited with code %d\n", result);
     print_error_message(result);
 
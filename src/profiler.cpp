@@ -0,0 +1,114 @@
+#include "profiler.hpp"
+
+namespace tc::profiler {
+
+namespace {
+
+const int rolling_window = 32; // samples per stage
+
+struct stage_stats {
+    float samples[rolling_window] = {};
+    int n_samples = 0;
+    int next = 0;
+};
+
+std::mutex mutex;
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// stages in order of first appearance (the debug info order)
+std::vector<std::string> stage_order;
+std::map<std::string, stage_stats> stages;
+
+FILE *trace_file = nullptr;
+bool first_trace_event = true;
+std::map<std::thread::id, int> thread_ids;
+
+int trace_thread_id() {
+    // small, stable ids in order of appearance (the render thread comes first)
+    auto i = thread_ids.find(std::this_thread::get_id());
+    if (i != thread_ids.end()) return i->second;
+
+    int id = thread_ids.size();
+    thread_ids[std::this_thread::get_id()] = id;
+    fprintf(trace_file, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"thread %d\"}}",
+            first_trace_event ? "" : ",", id, id);
+    first_trace_event = false;
+    return id;
+}
+
+} /* end of anonymous namespace */
+
+// Scoped_Timer:
+
+Scoped_Timer::Scoped_Timer(const char *p_name, bool p_thread_span)
+    : name(p_name), thread_span(p_thread_span), start(std::chrono::steady_clock::now()) {
+}
+
+Scoped_Timer::~Scoped_Timer() {
+    auto end = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock {mutex};
+
+    if (!thread_span) {
+        auto i = stages.find(name);
+        if (i == stages.end()) {
+            stage_order.push_back(name);
+            i = stages.emplace(name, stage_stats {}).first;
+        }
+        stage_stats &s = i->second;
+        s.samples[s.next] = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000000.0f;
+        s.next = (s.next + 1) % rolling_window;
+        if (s.n_samples < rolling_window) ++s.n_samples;
+    }
+
+    if (trace_file) {
+        int tid = trace_thread_id();
+        long long ts = std::chrono::duration_cast<std::chrono::microseconds>(start - epoch).count();
+        long long dur = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        fprintf(trace_file, "%s\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": 1, \"tid\": %d}",
+                first_trace_event ? "" : ",", name, thread_span ? "thread" : "stage", ts, dur, tid);
+        first_trace_event = false;
+    }
+}
+
+// trace:
+
+bool start_trace(const std::string path) {
+    if (path.empty()) return true;
+
+    std::lock_guard<std::mutex> lock {mutex};
+    trace_file = fopen(path.c_str(), "w");
+    if (!trace_file) return false;
+
+    fprintf(trace_file, "{\"traceEvents\": [");
+    return true;
+}
+
+void end_trace() {
+    std::lock_guard<std::mutex> lock {mutex};
+    if (!trace_file) return;
+
+    fprintf(trace_file, "\n]}\n");
+    fclose(trace_file);
+    trace_file = nullptr;
+}
+
+// stats:
+
+std::string stats_string() {
+    std::lock_guard<std::mutex> lock {mutex};
+
+    std::stringstream ss;
+    ss << std::fixed << std::setprecision(2);
+
+    for (const std::string &name : stage_order) {
+        const stage_stats &s = stages[name];
+        float sum = 0.0f;
+        for (int i = 0; i < s.n_samples; ++i) sum += s.samples[i];
+        ss << name << ": " << (s.n_samples ? sum / s.n_samples : 0.0f) << "ms\n";
+    }
+
+    return ss.str();
+}
+
+} /* end of namespace tc::profiler */
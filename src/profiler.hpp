@@ -0,0 +1,39 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+namespace tc::profiler {
+
+/* Measures the time from construction to destruction.
+ * Stage timers feed the rolling averages shown in the debug info,
+ * thread spans (eg. one per OpenMP thread) only go to the trace file. */
+class Scoped_Timer {
+public:
+    Scoped_Timer(const char *p_name, bool p_thread_span = false);
+    ~Scoped_Timer();
+
+private:
+    const char *name;
+    bool thread_span;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Chrome / Perfetto trace file (json), empty path: tracing off
+bool start_trace(const std::string path);
+void end_trace();
+
+// rolling averages of all stages, one per line
+std::string stats_string();
+
+} /* end of namespace tc::profiler */
+
+#endif /* end of include guard: PROFILER_HPP */
@@ -2,6 +2,7 @@
 #define BUFFER_HPP
 
 #include <vector>
+#include <algorithm>
 
 namespace tc {
 
@@ -15,6 +16,15 @@ struct buffer {
     }
 
     void clear(int x_size, int y_size, T value) {
+        // reuse the columns if the size didn't change
+        if (buf.size() == static_cast<long unsigned int>(x_size) &&
+            (buf.empty() || buf[0].size() == static_cast<long unsigned int>(y_size))) {
+            for (auto &column : buf) {
+                std::fill(column.begin(), column.end(), value);
+            }
+            return;
+        }
+
         buf.clear();
         buf = std::vector<std::vector<T>> (static_cast<long unsigned int>(x_size), std::vector<T> {});
         for (auto &column : buf) {
@@ -0,0 +1,33 @@
+#ifndef CELL_HPP
+#define CELL_HPP
+
+#include <cstdint>
+
+namespace tc {
+
+namespace cell_attr {
+    enum Cell_Attr {
+        BOLD = 1,
+        REVERSE = 2,
+    };
+} /* end of namespace cell_attr */
+
+/* Packed cell colors: 0x00rrggbb for rgb colors, INDEXED | n for
+ * color n of the 256 color palette and NONE for the terminal default. */
+namespace cell_color {
+    const uint32_t NONE = 0xff000000;
+    const uint32_t INDEXED = 0x01000000;
+} /* end of namespace cell_color */
+
+/* One terminal character cell as it is (or will be) shown on screen.
+ * The glyph is a unicode code point, '\0' marks an empty cell (used by the hud buffer). */
+struct cell {
+    char32_t glyph = ' ';
+    unsigned char attr = 0;
+    uint32_t fg = cell_color::NONE;
+    uint32_t bg = cell_color::NONE;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: CELL_HPP */
@@ -4,29 +4,97 @@ using namespace std;
 
 namespace tc::draw_util {
 
-string ansi_color_string(Col_Type type, glm::vec3 c) {
-    // example: "\e[48;2;255;0;0m" (set bg to red)
-    return string("\e[").append(type == BG ? "48" : "38")
-                        .append(";2;")
-                        .append(to_string(int(clamp(c.r, 0.0f, 1.0f)*255.0f))).append(";")
-                        .append(to_string(int(clamp(c.g, 0.0f, 1.0f)*255.0f))).append(";")
-                        .append(to_string(int(clamp(c.b, 0.0f, 1.0f)*255.0f))).append("m");
+namespace {
+
+/* Nearest xterm 256 color palette index (6x6x6 cube: 16-231, gray ramp:
+ * 232-255) for every rgb555 color, so quantizing is a single lookup. */
+struct palette_lut_table {
+    palette_lut_table() {
+        const int cube_levels[6] = {0, 95, 135, 175, 215, 255};
+
+        glm::ivec3 palette[256];
+        for (int i = 0; i < 216; ++i) {
+            palette[16 + i] = {cube_levels[i / 36], cube_levels[i / 6 % 6], cube_levels[i % 6]};
+        }
+        for (int i = 0; i < 24; ++i) {
+            palette[232 + i] = glm::ivec3(8 + i * 10);
+        }
+
+        for (int i = 0; i < 32768; ++i) {
+            // expand 5 bit components to 8 bit
+            glm::ivec3 c {(i >> 10 & 0x1f) * 255 / 31,
+                          (i >> 5 & 0x1f) * 255 / 31,
+                          (i & 0x1f) * 255 / 31};
+
+            int best_index = 16;
+            int best_distance = numeric_limits<int>::max();
+            for (int p = 16; p < 256; ++p) {
+                glm::ivec3 d = c - palette[p];
+                // weighted like the eye's sensitivity (roughly 3:4:2)
+                int distance = 3*d.r*d.r + 4*d.g*d.g + 2*d.b*d.b;
+                if (distance < best_distance) {
+                    best_distance = distance;
+                    best_index = p;
+                }
+            }
+            entries[i] = best_index;
+        }
+    }
+
+    unsigned char entries[32768];
+};
+
+const palette_lut_table palette_lut;
+
+} /* end of anonymous namespace */
+
+uint32_t rgb_color(glm::vec3 c) {
+    return uint32_t(clamp(c.r, 0.0f, 1.0f)*255.0f) << 16
+         | uint32_t(clamp(c.g, 0.0f, 1.0f)*255.0f) << 8
+         | uint32_t(clamp(c.b, 0.0f, 1.0f)*255.0f);
 }
 
-string ansi_bw_color_string(Col_Type type, glm::vec3 c) {
-    // example: "\e[38;5;127m" (set fg to gray)
+uint32_t bw_color(glm::vec3 c) {
     float avg = (c.r + c.g + c.b) * 0.3333f;
     int value = glm::mix(231.1f, 256.1f, clamp(avg, 0.0f, 1.0f));
     // the following lines are needed because of stupid ansi index order
     if (value == 231) value = 16; // white to black
     if (value == 256) value = 231; // light_gray+1 to white
 
-    return string("\e[").append(type == BG ? "48" : "38")
-                        .append(";5;")
-                        .append(to_string(value)).append("m");
+    return cell_color::INDEXED | value;
+}
+
+uint32_t palette_color(glm::vec3 c) {
+    const int r = clamp(c.r, 0.0f, 1.0f) * 31.0f + 0.5f;
+    const int g = clamp(c.g, 0.0f, 1.0f) * 31.0f + 0.5f;
+    const int b = clamp(c.b, 0.0f, 1.0f) * 31.0f + 0.5f;
+    return cell_color::INDEXED | palette_lut.entries[r << 10 | g << 5 | b];
 }
 
-string ascii_bw_color_string(Col_Type type, glm::vec3 c) {
+glm::vec3 bayer_dither(glm::vec3 c, glm::ivec2 coord) {
+    // 4x4 ordered dithering matrix
+    const int bayer[4][4] = {
+        { 0,  8,  2, 10},
+        {12,  4, 14,  6},
+        { 3, 11,  1,  9},
+        {15,  7, 13,  5},
+    };
+    // offset of up to half a palette step (~40/255 between cube levels)
+    const float step = 40.0f / 255.0f;
+    float threshold = (bayer[coord.y & 3][coord.x & 3] + 0.5f) / 16.0f - 0.5f;
+    return c + glm::vec3(threshold * step);
+}
+
+uint32_t auto_color(glm::vec3 c) {
+    if (U.color_mode == color_mode::COMPAT || U.color_mode == color_mode::HALFBLOCK_COMPAT)
+        return bw_color(c);
+    else if (U.color_mode == color_mode::PALETTE256)
+        return palette_color(c);
+    else
+        return rgb_color(c);
+}
+
+char ascii_bw_char(glm::vec3 c) {
     // convert bw value to ascii character
     // string chars = " .,:+#@";
     string chars = "$@B%8&WM#*oahkbdpqwmZO0QLCJUYXzcvunxrjft/\\|()1{}[]?-_+~<>i!lI;:,\"^`'.";
@@ -34,19 +102,24 @@ string ascii_bw_color_string(Col_Type type, glm::vec3 c) {
 
     float avg = (c.r + c.g + c.b) * 0.3333f;
     int value = clamp(1.0f - avg, 0.0f, 1.0f) * chars.length()-1;
-    return string {chars[value]};
+    return chars[value];
 }
 
-string auto_color_string(Col_Type type, glm::vec3 c) {
-    if (U.color_mode == "COMPAT")
-        return ansi_bw_color_string(type, c);
-    else
-        return ansi_color_string(type, c);
-}
+/* "redmean" weighted distance, a cheap approximation of perceived color
+ * difference (range 0 to ~765); reference: https://www.compuphase.com/cmetric.htm
+ * Colors that aren't both rgb are either equal (0) or not (infinity). */
+float color_distance(uint32_t a, uint32_t b) {
+    if (a == b) return 0.0f;
+    if ((a | b) & 0xff000000) return numeric_limits<float>::infinity();
 
-string ansi_clear_string() {
-    // clear all formatting
-    return "\e[0m";
+    float r_mean = (float)(((a >> 16) & 0xff) + ((b >> 16) & 0xff)) * 0.5f;
+    float dr = (float)((a >> 16) & 0xff) - (float)((b >> 16) & 0xff);
+    float dg = (float)((a >> 8) & 0xff) - (float)((b >> 8) & 0xff);
+    float db = (float)(a & 0xff) - (float)(b & 0xff);
+
+    return sqrt((2.0f + r_mean / 256.0f) * dr*dr
+              + 4.0f * dg*dg
+              + (2.0f + (255.0f - r_mean) / 256.0f) * db*db);
 }
 
 /* method from here:
@@ -74,7 +147,7 @@ float cc_signed_area(glm::vec2 a, glm::vec2 b, glm::vec2 c) {
     return  glm::cross(glm::vec3(b, 0.0f) - glm::vec3(a, 0.0f), glm::vec3(c, 0.0f) - glm::vec3(a, 0.0f)).z;
 }
 
-bool is_tri_in_NDC(tri t) {
+bool is_tri_in_NDC(const tri &t) {
     const glm::vec3 a = t.vertices[0].pos;
     const glm::vec3 b = t.vertices[1].pos;
     const glm::vec3 c = t.vertices[2].pos;
@@ -95,6 +168,101 @@ bool is_tri_in_NDC(tri t) {
     );
 }
 
+/* The 6 planes (xyz: normal pointing inside, w: offset) of the view
+ * frustum of a view projection matrix, in world space.
+ * reference: https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf */
+void frustum_planes(const glm::mat4 &VP, glm::vec4 *planes) {
+    const glm::mat4 rows = glm::transpose(VP);
+    for (int i = 0; i < 3; ++i) {
+        planes[i * 2] = rows[3] + rows[i];
+        planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+}
+
+/* Conservative: false only if the box is completely outside of one plane
+ * (tested with the box corner furthest along the plane normal). */
+bool is_box_in_frustum(const glm::vec4 *planes, glm::vec3 bb_min, glm::vec3 bb_max) {
+    for (int i = 0; i < 6; ++i) {
+        const glm::vec3 n = planes[i];
+        const glm::vec3 p {n.x >= 0.0f ? bb_max.x : bb_min.x,
+                           n.y >= 0.0f ? bb_max.y : bb_min.y,
+                           n.z >= 0.0f ? bb_max.z : bb_min.z};
+        if (glm::dot(n, p) + planes[i].w < 0.0f) return false;
+    }
+    return true;
+}
+
+/* NDC bounds of a world space box, from its corners.
+ * Returns false if part of the box is behind the near plane
+ * (the bounds would be meaningless). */
+bool project_box(const glm::mat4 &VP, glm::vec3 bb_min, glm::vec3 bb_max, glm::vec3 *ndc_min_ptr, glm::vec3 *ndc_max_ptr) {
+    glm::vec3 ndc_min {std::numeric_limits<float>::infinity()};
+    glm::vec3 ndc_max {-std::numeric_limits<float>::infinity()};
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec4 p = VP * glm::vec4(corner & 1 ? bb_max.x : bb_min.x,
+                                           corner & 2 ? bb_max.y : bb_min.y,
+                                           corner & 4 ? bb_max.z : bb_min.z,
+                                           1.0f);
+        if (p.z + p.w < 0.0f) return false;
+
+        const glm::vec3 ndc = glm::vec3(p) / p.w;
+        ndc_min = glm::min(ndc_min, ndc);
+        ndc_max = glm::max(ndc_max, ndc);
+    }
+    *ndc_min_ptr = ndc_min;
+    *ndc_max_ptr = ndc_max;
+    return true;
+}
+
+/* Sutherland-Hodgman clipping of a clip space triangle (before the
+ * depth division) against the near plane z + w >= 0.
+ * Writes 0 to 2 triangles with the winding of t into out and returns
+ * how many. All vertex attributes are interpolated linearly, which is
+ * correct in clip space. */
+int clip_tri_near(const tri &t, tri *out) {
+    float d[3];
+    int n_inside = 0;
+    for (int i = 0; i < 3; ++i) {
+        d[i] = t.vertices[i].pos.z + t.vertices[i].pos.w;
+        if (d[i] >= 0.0f) ++n_inside;
+    }
+
+    if (n_inside == 0) return 0;
+    if (n_inside == 3) {
+        out[0] = t;
+        return 1;
+    }
+
+    auto lerp_vertex = [](const vertex &a, const vertex &b, float f) {
+        vertex v = a;
+        v.pos = glm::mix(a.pos, b.pos, f);
+        v.tex_coord = glm::mix(a.tex_coord, b.tex_coord, f);
+        v.ao = glm::mix(a.ao, b.ao, f);
+        v.distance = glm::mix(a.distance, b.distance, f);
+        return v;
+    };
+
+    // walk the edges, keeping inside vertices and adding intersections
+    vertex polygon[4];
+    int n_vertices = 0;
+    for (int i = 0; i < 3; ++i) {
+        const int j = (i + 1) % 3;
+        if (d[i] >= 0.0f) polygon[n_vertices++] = t.vertices[i];
+        if ((d[i] >= 0.0f) != (d[j] >= 0.0f)) {
+            polygon[n_vertices++] = lerp_vertex(t.vertices[i], t.vertices[j], d[i] / (d[i] - d[j]));
+        }
+    }
+
+    // triangle fan
+    for (int i = 0; i < n_vertices - 2; ++i) {
+        out[i] = t;
+        out[i].vertices[0] = polygon[0];
+        out[i].vertices[1] = polygon[i + 1];
+        out[i].vertices[2] = polygon[i + 2];
+    }
+    return n_vertices - 2;
+}
+
 /* following two functions from: https://stackoverflow.com/questions/71420930/random-number-generator-with-3-inputs */
 int rotl32(int n, char k) {
     int a = n << k;
@@ -3,6 +3,7 @@
 
 #include "../glm.hpp"
 #include "tri.hpp"
+#include "cell.hpp"
 #include "../user_settings.hpp"
 
 #include <string>
@@ -10,6 +11,7 @@
 #include <cmath>
 #include <random>
 #include <limits>
+#include <cstdint>
 
 using namespace std;
 
@@ -17,22 +19,30 @@ namespace tc::draw_util {
 
 enum Col_Type {BG, FG};
 
-string ansi_color_string(Col_Type type, glm::vec3 c);
+uint32_t rgb_color(glm::vec3 c);
 
-string ansi_bw_color_string(Col_Type type, glm::vec3 c);
+uint32_t bw_color(glm::vec3 c);
 
-string ascii_bw_color_string(Col_Type type, glm::vec3 c);
+uint32_t palette_color(glm::vec3 c);
 
-string auto_color_string(Col_Type type, glm::vec3 c);
+glm::vec3 bayer_dither(glm::vec3 c, glm::ivec2 coord);
 
-string ansi_clear_string();
+uint32_t auto_color(glm::vec3 c);
+
+char ascii_bw_char(glm::vec3 c);
+
+float color_distance(uint32_t a, uint32_t b);
 
 float half_plane(glm::vec2 p1, glm::vec2 p2, glm::vec2 p3);
 bool is_point_in_triangle(glm::vec2 pt, glm::vec2 v1, glm::vec2 v2, glm::vec2 v3);
 
 float cc_signed_area(glm::vec2 a, glm::vec2 b, glm::vec2 c);
 
-bool is_tri_in_NDC(tri t);
+bool is_tri_in_NDC(const tri &t);
+int clip_tri_near(const tri &t, tri *out);
+void frustum_planes(const glm::mat4 &VP, glm::vec4 *planes);
+bool is_box_in_frustum(const glm::vec4 *planes, glm::vec3 bb_min, glm::vec3 bb_max);
+bool project_box(const glm::mat4 &VP, glm::vec3 bb_min, glm::vec3 bb_max, glm::vec3 *ndc_min_ptr, glm::vec3 *ndc_max_ptr);
 
 int rotl32(int n, char k);
 int three_input_random(int x, int y, int z);
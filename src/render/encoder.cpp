@@ -0,0 +1,198 @@
+#include "encoder.hpp"
+
+namespace tc {
+
+namespace {
+
+/* pre-rendered decimal strings of 0 to 999
+ * (color components, cursor coordinates and palette indices) */
+struct dec_string {
+    char length;
+    char digits[3];
+};
+
+const unsigned int dec_lut_size = 1000;
+
+struct dec_lut_table {
+    dec_lut_table() {
+        for (unsigned int n = 0; n < dec_lut_size; ++n) {
+            if (n >= 100) entries[n] = {3, {char('0' + n / 100), char('0' + n / 10 % 10), char('0' + n % 10)}};
+            else if (n >= 10) entries[n] = {2, {char('0' + n / 10), char('0' + n % 10), 0}};
+            else entries[n] = {1, {char('0' + n), 0, 0}};
+        }
+    }
+
+    dec_string entries[dec_lut_size];
+};
+
+const dec_lut_table dec_lut;
+
+} /* end of anonymous namespace */
+
+// public:
+
+Encoder::Encoder() {
+    bytes.reserve(1 << 16);
+}
+
+void Encoder::begin_frame(int p_X_size) {
+    X_size = p_X_size;
+    bytes.clear();
+    // anything may have moved the cursor in between frames
+    cursor_x = -1;
+    cursor_y = -1;
+}
+
+void Encoder::move_cursor(int x, int y) {
+    if (x == cursor_x && y == cursor_y) return;
+
+    if (y == cursor_y && x > cursor_x && cursor_x >= 0) {
+        // cursor forward: "\e[nC" ("\e[C" for n = 1)
+        append("\e[", 2);
+        if (x - cursor_x > 1) append_number(x - cursor_x);
+        append("C", 1);
+    } else {
+        // cursor position (1-based): "\e[row;colH"
+        append("\e[", 2);
+        append_number(y + 1);
+        append(";", 1);
+        append_number(x + 1);
+        append("H", 1);
+    }
+
+    cursor_x = x;
+    cursor_y = y;
+}
+
+void Encoder::put_cell(const cell &c) {
+    set_style(c);
+    append_glyph(c.glyph);
+
+    /* After the last column the cursor is stuck in the pending wrap
+     * state, so we don't trust its position after that. */
+    ++cursor_x;
+    if (cursor_x >= X_size) {
+        cursor_x = -1;
+        cursor_y = -1;
+    }
+}
+
+void Encoder::end_frame() {
+    if (bytes.empty()) return;
+
+    // leave the terminal in a clean state between frames
+    append("\e[0m", 4);
+    style_known = true;
+    attr = 0;
+    fg = cell_color::NONE;
+    bg = cell_color::NONE;
+}
+
+const std::vector<char> &Encoder::get_bytes() const {
+    return bytes;
+}
+
+size_t Encoder::size() const {
+    return bytes.size();
+}
+
+// private:
+
+void Encoder::append(const char *str, size_t length) {
+    bytes.insert(bytes.end(), str, str + length);
+}
+
+void Encoder::append_number(unsigned int n) {
+    if (n < dec_lut_size) {
+        const dec_string &d = dec_lut.entries[n];
+        append(d.digits, d.length);
+    } else {
+        append_number(n / 10);
+        bytes.push_back(char('0' + n % 10));
+    }
+}
+
+void Encoder::append_glyph(char32_t glyph) {
+    // utf-8 encoding
+    if (glyph < 0x80) {
+        bytes.push_back(char(glyph));
+    } else if (glyph < 0x800) {
+        bytes.push_back(char(0xc0 | (glyph >> 6)));
+        bytes.push_back(char(0x80 | (glyph & 0x3f)));
+    } else if (glyph < 0x10000) {
+        bytes.push_back(char(0xe0 | (glyph >> 12)));
+        bytes.push_back(char(0x80 | ((glyph >> 6) & 0x3f)));
+        bytes.push_back(char(0x80 | (glyph & 0x3f)));
+    } else {
+        bytes.push_back(char(0xf0 | (glyph >> 18)));
+        bytes.push_back(char(0x80 | ((glyph >> 12) & 0x3f)));
+        bytes.push_back(char(0x80 | ((glyph >> 6) & 0x3f)));
+        bytes.push_back(char(0x80 | (glyph & 0x3f)));
+    }
+}
+
+void Encoder::append_color(bool background, uint32_t color) {
+    // without separators, example: "48;2;255;0;0" or "38;5;127"
+    if (color == cell_color::NONE) {
+        append(background ? "49" : "39", 2);
+    } else if (color & cell_color::INDEXED) {
+        append(background ? "48;5;" : "38;5;", 5);
+        append_number(color & 0xff);
+    } else {
+        append(background ? "48;2;" : "38;2;", 5);
+        append_number((color >> 16) & 0xff);
+        bytes.push_back(';');
+        append_number((color >> 8) & 0xff);
+        bytes.push_back(';');
+        append_number(color & 0xff);
+    }
+}
+
+void Encoder::set_style(const cell &c) {
+    bool started = false;
+    auto separator = [&]() {
+        if (started) {
+            bytes.push_back(';');
+        } else {
+            append("\e[", 2);
+            started = true;
+        }
+    };
+
+    // attributes can only be turned off with a full reset
+    if (!style_known || (attr & ~c.attr)) {
+        separator();
+        bytes.push_back('0');
+        style_known = true;
+        attr = 0;
+        fg = cell_color::NONE;
+        bg = cell_color::NONE;
+    }
+
+    if ((c.attr & cell_attr::BOLD) && !(attr & cell_attr::BOLD)) {
+        separator();
+        bytes.push_back('1');
+    }
+    if ((c.attr & cell_attr::REVERSE) && !(attr & cell_attr::REVERSE)) {
+        separator();
+        bytes.push_back('7');
+    }
+    attr = c.attr;
+
+    // the foreground color of a space is invisible unless reversed
+    bool fg_visible = c.glyph != ' ' || (c.attr & cell_attr::REVERSE);
+    if (fg_visible && c.fg != fg) {
+        separator();
+        append_color(false, c.fg);
+        fg = c.fg;
+    }
+    if (c.bg != bg) {
+        separator();
+        append_color(true, c.bg);
+        bg = c.bg;
+    }
+
+    if (started) bytes.push_back('m');
+}
+
+} /* end of namespace tc */
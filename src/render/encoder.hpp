@@ -0,0 +1,49 @@
+#ifndef ENCODER_HPP
+#define ENCODER_HPP
+
+#include "cell.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace tc {
+
+/* Encodes cells and cursor movements into a reusable byte buffer of
+ * escape sequences, only emitting SGR codes that change the current
+ * terminal state. The whole frame can then be written at once. */
+class Encoder {
+public:
+    Encoder();
+
+    void begin_frame(int p_X_size);
+    void move_cursor(int x, int y);
+    void put_cell(const cell &c);
+    void end_frame();
+
+    const std::vector<char> &get_bytes() const;
+    size_t size() const;
+
+private:
+    void append(const char *str, size_t length);
+    void append_number(unsigned int n);
+    void append_glyph(char32_t glyph);
+    void append_color(bool background, uint32_t color);
+    void set_style(const cell &c);
+
+    std::vector<char> bytes;
+
+    int X_size = 0;
+
+    // terminal state
+    int cursor_x = -1; // -1: unknown
+    int cursor_y = -1;
+    bool style_known = false;
+    unsigned char attr = 0;
+    uint32_t fg = cell_color::NONE;
+    uint32_t bg = cell_color::NONE;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: ENCODER_HPP */
@@ -0,0 +1,98 @@
+#include "fragment_buffer.hpp"
+
+using namespace std;
+
+namespace tc {
+
+// public:
+
+void Fragment_Buffer::clear(int p_X_res, int p_Y_res) {
+    // whole tiles, the ones at the right and bottom edge are padded
+    const int n_tiles_x = (p_X_res + tile_size::width - 1) / tile_size::width;
+    n_tiles_y = (p_Y_res + tile_size::height - 1) / tile_size::height;
+    const size_t n_pixels = static_cast<size_t>(n_tiles_x) * n_tiles_y * tile_size::width * tile_size::height;
+
+    // storage is only reallocated when the resolution changes
+    if (p_X_res != X_res || p_Y_res != Y_res) {
+        X_res = p_X_res;
+        Y_res = p_Y_res;
+        opaque_buf.resize(n_pixels);
+        layer_pool.resize(n_pixels * max_layers);
+        layer_counts.resize(n_pixels);
+    }
+
+    const float infinity = numeric_limits<float>::infinity();
+    for (size_t i = 0; i < n_pixels; ++i) {
+        opaque_buf[i].tri_index = no_tri;
+        opaque_buf[i].depth = infinity;
+        layer_counts[i] = 0;
+    }
+}
+
+void Fragment_Buffer::insert(int x, int y, const vis_record &vis, float opacity) {
+    const size_t i = index(x, y);
+
+    vis_record &opaque = opaque_buf[i];
+    layer_record *layers = &layer_pool[i * max_layers];
+    int n_layers = layer_counts[i];
+
+    if (vis.depth < opaque.depth) {
+        if (opacity == 1.0f) {
+            opaque = vis;
+
+            // translucent layers behind the new opaque record are hidden now
+            while (n_layers > 0 && layers[n_layers - 1].vis.depth >= vis.depth) --n_layers;
+        } else {
+            // sorted insert, the farthest layer falls out when full
+            int pos = n_layers;
+            while (pos > 0 && layers[pos - 1].vis.depth > vis.depth) --pos;
+
+            if (pos < max_layers) {
+                for (int j = min(n_layers, max_layers - 1); j > pos; --j) layers[j] = layers[j - 1];
+                layers[pos] = layer_record {vis, opacity};
+                n_layers = min(n_layers + 1, max_layers);
+            }
+        }
+        layer_counts[i] = n_layers;
+    }
+}
+
+void Fragment_Buffer::insert_opaque(int x, int y, const vis_record &vis) {
+    const size_t i = index(x, y);
+
+    vis_record &opaque = opaque_buf[i];
+    if (vis.depth >= opaque.depth) return;
+    opaque = vis;
+
+    // translucent layers behind the new opaque record are hidden now
+    int n_layers = layer_counts[i];
+    if (n_layers == 0) return;
+    const layer_record *layers = &layer_pool[i * max_layers];
+    while (n_layers > 0 && layers[n_layers - 1].vis.depth >= vis.depth) --n_layers;
+    layer_counts[i] = n_layers;
+}
+
+float Fragment_Buffer::get_depth(int x, int y) const {
+    return opaque_buf[index(x, y)].depth;
+}
+
+const vis_record *Fragment_Buffer::get_opaque(int x, int y) const {
+    const vis_record &opaque = opaque_buf[index(x, y)];
+    return opaque.tri_index != no_tri ? &opaque : nullptr;
+}
+
+const layer_record *Fragment_Buffer::get_layers(int x, int y, int *n_layers_ptr) const {
+    const size_t i = index(x, y);
+    *n_layers_ptr = layer_counts[i];
+    return &layer_pool[i * max_layers];
+}
+
+// private:
+
+size_t Fragment_Buffer::index(int x, int y) const {
+    const int tile = (x / tile_size::width) * n_tiles_y + y / tile_size::height;
+    const int in_tile = (x % tile_size::width) * tile_size::height + y % tile_size::height;
+    return static_cast<size_t>(tile) * tile_size::width * tile_size::height + in_tile;
+}
+
+} /* end of namespace tc */
@@ -0,0 +1,73 @@
+#ifndef FRAGMENT_BUFFER_HPP
+#define FRAGMENT_BUFFER_HPP
+
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+namespace tc {
+
+// screen tiles in pixels, the unit of work of the rasterizer
+namespace tile_size {
+    const int width = 16;
+    const int height = 8;
+} /* end of namespace tile_size */
+
+/* What the rasterizer stores per pixel (visibility buffer): which
+ * triangle of the mesh is visible, its depth and its perspective-correct
+ * barycentric coordinates (b0 = 1 - b1 - b2). Material, texture and
+ * lighting are only resolved afterwards, once per visible pixel. */
+struct vis_record {
+    uint32_t tri_index;
+    float depth;
+    float b1;
+    float b2;
+};
+
+struct layer_record {
+    vis_record vis;
+    float opacity;
+};
+
+/* Per-pixel visibility storage without allocations per frame:
+ * the nearest opaque record in a flat depth layer, plus up to
+ * max_layers translucent records in front of it (a k-buffer, sorted
+ * near to far) in one preallocated pool.
+ * Pixels are stored tile by tile, so that a tile's records are close
+ * together in memory. There are no locks: the rasterizer gives every
+ * tile to one thread. */
+class Fragment_Buffer {
+public:
+    static const int max_layers = 4;
+    static const uint32_t no_tri = std::numeric_limits<uint32_t>::max();
+
+    Fragment_Buffer() {}
+
+    void clear(int p_X_res, int p_Y_res);
+    void insert(int x, int y, const vis_record &vis, float opacity);
+    // insert with opacity 1, for callers that know it statically
+    void insert_opaque(int x, int y, const vis_record &vis);
+
+    // depth of the opaque record (infinity if there is none), for early depth rejection
+    float get_depth(int x, int y) const;
+    // nullptr if there is no opaque record
+    const vis_record *get_opaque(int x, int y) const;
+    // translucent records in front of the opaque one, nearest first
+    const layer_record *get_layers(int x, int y, int *n_layers_ptr) const;
+
+private:
+    size_t index(int x, int y) const;
+
+    int X_res = 0;
+    int Y_res = 0;
+    int n_tiles_y = 0;
+
+    std::vector<vis_record> opaque_buf; // depth is infinity where empty
+    std::vector<layer_record> layer_pool; // max_layers per pixel
+    std::vector<unsigned char> layer_counts;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: FRAGMENT_BUFFER_HPP */
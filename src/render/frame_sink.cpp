@@ -0,0 +1,58 @@
+#include "frame_sink.hpp"
+
+namespace tc {
+
+// FD_Sink:
+
+FD_Sink::FD_Sink(int p_fd, bool p_owns_fd) : fd(p_fd), owns_fd(p_owns_fd) {
+}
+
+FD_Sink::~FD_Sink() {
+    if (owns_fd) close(fd);
+}
+
+bool FD_Sink::write_bytes(const char *data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, data + written, size - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+// PPM_Sink:
+
+PPM_Sink::PPM_Sink(std::string p_prefix) : prefix(p_prefix) {
+}
+
+bool PPM_Sink::write_pixels(const buffer<glm::vec3> &fbuf, int X_res, int Y_res) {
+    char file_name_suffix[16];
+    snprintf(file_name_suffix, sizeof(file_name_suffix), "_%06d.ppm", ++frame_index);
+    std::string file_name = prefix + file_name_suffix;
+
+    FILE *file = fopen(file_name.c_str(), "wb");
+    if (!file) return false;
+
+    fprintf(file, "P6\n%d %d\n255\n", X_res, Y_res);
+
+    std::string row;
+    row.resize(X_res * 3);
+    bool success = true;
+    for (int y = 0; y < Y_res && success; ++y) {
+        for (int x = 0; x < X_res; ++x) {
+            const glm::vec3 c = glm::clamp(fbuf.buf[x][y], 0.0f, 1.0f) * 255.0f;
+            row[x*3 + 0] = static_cast<unsigned char>(c.r);
+            row[x*3 + 1] = static_cast<unsigned char>(c.g);
+            row[x*3 + 2] = static_cast<unsigned char>(c.b);
+        }
+        success = fwrite(row.data(), 1, row.size(), file) == row.size();
+    }
+
+    return fclose(file) == 0 && success;
+}
+
+} /* end of namespace tc */
@@ -0,0 +1,61 @@
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include "../glm.hpp"
+
+#include "buffer.hpp"
+
+#include <string>
+#include <cstdio>
+#include <cstddef>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace tc {
+
+/* Destination of finished frames. Sinks either take the encoded ansi
+ * byte stream (write_bytes) or the raw framebuffer (write_pixels),
+ * depending on wants_pixels(). Functions return false on failure. */
+class Frame_Sink {
+public:
+    virtual ~Frame_Sink() {}
+
+    virtual bool wants_pixels() const {return false;}
+    virtual bool write_bytes(const char *data, size_t size) {return true;}
+    virtual bool write_pixels(const buffer<glm::vec3> &fbuf, int X_res, int Y_res) {return true;}
+};
+
+// Discards everything (the frames are still encoded)
+class Null_Sink : public Frame_Sink {
+};
+
+// Writes the ansi byte stream to a file descriptor (stdout for the terminal)
+class FD_Sink : public Frame_Sink {
+public:
+    FD_Sink(int p_fd, bool p_owns_fd = false);
+    ~FD_Sink();
+
+    bool write_bytes(const char *data, size_t size) override;
+
+private:
+    int fd;
+    bool owns_fd;
+};
+
+// Writes every frame as a binary ppm image: <prefix>_000001.ppm, ...
+class PPM_Sink : public Frame_Sink {
+public:
+    PPM_Sink(std::string p_prefix);
+
+    bool wants_pixels() const override {return true;}
+    bool write_pixels(const buffer<glm::vec3> &fbuf, int X_res, int Y_res) override;
+
+private:
+    std::string prefix;
+    int frame_index = 0;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: FRAME_SINK_HPP */
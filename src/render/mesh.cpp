@@ -1,5 +1,7 @@
 #include "mesh.hpp"
 
+#include <limits>
+
 namespace tc {
 
 mesh::mesh(std::vector<tri> p_tri_list) : tri_list(p_tri_list) {
@@ -8,6 +10,12 @@ mesh::mesh(std::vector<tri> p_tri_list) : tri_list(p_tri_list) {
 mesh::mesh() {}
 
 void mesh::append(mesh m) {
+    const int offset = tri_list.size();
+    for (mesh_section s : m.sections) {
+        s.begin += offset;
+        s.end += offset;
+        sections.push_back(s);
+    }
     tri_list.insert(std::end(tri_list), std::begin(m.tri_list), std::end(m.tri_list));
 }
 
@@ -20,6 +28,23 @@ mesh mesh::transform(glm::mat4 M) {
         }
         m.tri_list.push_back(t);
     }
+
+    // bounding box of the transformed corners
+    for (mesh_section s : sections) {
+        glm::vec3 bb_min {std::numeric_limits<float>::infinity()};
+        glm::vec3 bb_max {-std::numeric_limits<float>::infinity()};
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec3 p = M * glm::vec4(corner & 1 ? s.bb_max.x : s.bb_min.x,
+                                              corner & 2 ? s.bb_max.y : s.bb_min.y,
+                                              corner & 4 ? s.bb_max.z : s.bb_min.z,
+                                              1.0f);
+            bb_min = glm::min(bb_min, p);
+            bb_max = glm::max(bb_max, p);
+        }
+        s.bb_min = bb_min;
+        s.bb_max = bb_max;
+        m.sections.push_back(s);
+    }
     return m;
 }
 
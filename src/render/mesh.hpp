@@ -1,6 +1,8 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include "../glm.hpp"
+
 #include "tri.hpp"
 
 #include <vector>
@@ -9,6 +11,14 @@ namespace tc {
 
 struct tri;
 
+// a range of a mesh's triangles with their bounding box, for culling
+struct mesh_section {
+    int begin; // index into tri_list
+    int end; // exclusive
+    glm::vec3 bb_min;
+    glm::vec3 bb_max;
+};
+
 struct mesh {
     mesh(std::vector<tri> p_tri_list);
     mesh();
@@ -17,6 +27,8 @@ struct mesh {
     mesh transform(glm::mat4 M);
 
     std::vector<tri> tri_list;
+    // optional: either empty or covering all triangles, in order
+    std::vector<mesh_section> sections;
 };
 
 } /* end of namespace tc */
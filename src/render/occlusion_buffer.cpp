@@ -0,0 +1,111 @@
+#include "occlusion_buffer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+namespace tc {
+
+// public:
+
+void Occlusion_Buffer::clear(int p_width, int p_height) {
+    // the pyramid is only rebuilt when the resolution changes
+    if (p_width != width || p_height != height || levels.empty()) {
+        width = p_width;
+        height = p_height;
+        levels.clear();
+        level_sizes.clear();
+
+        glm::ivec2 size {max(width, 1), max(height, 1)};
+        while (true) {
+            levels.push_back(vector<float>(static_cast<size_t>(size.x) * size.y));
+            level_sizes.push_back(size);
+            if (size.x == 1 && size.y == 1) break;
+            size = (size + 1) / 2;
+        }
+    }
+
+    fill(levels[0].begin(), levels[0].end(), numeric_limits<float>::infinity());
+}
+
+void Occlusion_Buffer::insert_occluder(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, float max_depth) {
+    // counter-clockwise, so that the inside is where all edge functions are >= 0
+    float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+    if (area == 0.0f) return;
+    if (area < 0.0f) swap(p1, p2);
+
+    auto inside = [&](glm::vec2 p) {
+        return (p1.x - p0.x) * (p.y - p0.y) - (p1.y - p0.y) * (p.x - p0.x) > 0.0f &&
+               (p2.x - p1.x) * (p.y - p1.y) - (p2.y - p1.y) * (p.x - p1.x) > 0.0f &&
+               (p0.x - p2.x) * (p.y - p2.y) - (p0.y - p2.y) * (p.x - p2.x) > 0.0f;
+    };
+
+    // texels with their center in the bounding box
+    const glm::vec2 bb_min = glm::min(glm::min(p0, p1), p2);
+    const glm::vec2 bb_max = glm::max(glm::max(p0, p1), p2);
+    const int x_begin = max(static_cast<int>(ceil(bb_min.x - 0.5f)), 0);
+    const int y_begin = max(static_cast<int>(ceil(bb_min.y - 0.5f)), 0);
+    const int x_end = min(static_cast<int>(floor(bb_max.x - 0.5f)) + 1, width); // exclusive
+    const int y_end = min(static_cast<int>(floor(bb_max.y - 0.5f)) + 1, height);
+
+    vector<float> &depth = levels[0];
+    for (int y = y_begin; y < y_end; ++y) {
+        for (int x = x_begin; x < x_end; ++x) {
+            if (inside({x + 0.5f, y + 0.5f})) {
+                float &d = depth[static_cast<size_t>(y) * width + x];
+                d = min(d, max_depth);
+            }
+        }
+    }
+}
+
+void Occlusion_Buffer::build_pyramid() {
+    for (size_t level = 1; level < levels.size(); ++level) {
+        const vector<float> &src = levels[level - 1];
+        const glm::ivec2 src_size = level_sizes[level - 1];
+        vector<float> &dst = levels[level];
+        const glm::ivec2 dst_size = level_sizes[level];
+
+        for (int y = 0; y < dst_size.y; ++y) {
+            for (int x = 0; x < dst_size.x; ++x) {
+                const int x0 = x * 2, x1 = min(x * 2 + 1, src_size.x - 1);
+                const int y0 = y * 2, y1 = min(y * 2 + 1, src_size.y - 1);
+                dst[static_cast<size_t>(y) * dst_size.x + x] = max(
+                    max(src[static_cast<size_t>(y0) * src_size.x + x0], src[static_cast<size_t>(y0) * src_size.x + x1]),
+                    max(src[static_cast<size_t>(y1) * src_size.x + x0], src[static_cast<size_t>(y1) * src_size.x + x1]));
+            }
+        }
+    }
+}
+
+/* True if the rectangle is behind the occluders everywhere:
+ * tested on the first level where it touches at most 2x2 texels. */
+bool Occlusion_Buffer::is_occluded(glm::vec2 rect_min, glm::vec2 rect_max, float min_depth) const {
+    int x0 = max(static_cast<int>(floor(rect_min.x)), 0);
+    int y0 = max(static_cast<int>(floor(rect_min.y)), 0);
+    int x1 = min(static_cast<int>(floor(rect_max.x)), width - 1);
+    int y1 = min(static_cast<int>(floor(rect_max.y)), height - 1);
+    if (x0 > x1 || y0 > y1) return false; // off screen, the frustum test keeps it for a reason
+
+    size_t level = 0;
+    while (level + 1 < levels.size() && (x1 - x0 > 1 || y1 - y0 > 1)) {
+        x0 /= 2;
+        y0 /= 2;
+        x1 /= 2;
+        y1 /= 2;
+        ++level;
+    }
+
+    const vector<float> &depth = levels[level];
+    const int level_width = level_sizes[level].x;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            if (min_depth <= depth[static_cast<size_t>(y) * level_width + x]) return false;
+        }
+    }
+    return true;
+}
+
+} /* end of namespace tc */
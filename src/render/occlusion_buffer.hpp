@@ -0,0 +1,37 @@
+#ifndef OCCLUSION_BUFFER_HPP
+#define OCCLUSION_BUFFER_HPP
+
+#include "../glm.hpp"
+
+#include <vector>
+
+namespace tc {
+
+/* Depth of the nearest occluders with a pyramid of farthest depths
+ * (hierarchical z), to test screen rectangles against at low resolution.
+ * Occluders are sampled at texel centers (strictly inside, so shared
+ * edges count as uncovered), which are the pixel centers the rasterizer
+ * samples, and store their farthest depth. So nothing visible is
+ * reported as occluded. Depths are NDC z, coordinates are in
+ * [0, width] x [0, height]. */
+class Occlusion_Buffer {
+public:
+    Occlusion_Buffer() {}
+
+    void clear(int p_width, int p_height);
+    void insert_occluder(glm::vec2 p0, glm::vec2 p1, glm::vec2 p2, float max_depth);
+    void build_pyramid();
+    bool is_occluded(glm::vec2 rect_min, glm::vec2 rect_max, float min_depth) const;
+
+private:
+    int width = 0;
+    int height = 0;
+
+    // level 0 is the full resolution, every level halves it (rounded up), row major
+    std::vector<std::vector<float>> levels;
+    std::vector<glm::ivec2> level_sizes;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: OCCLUSION_BUFFER_HPP */
@@ -0,0 +1,61 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "../glm.hpp"
+
+#include "vertex.hpp"
+#include "fragment.hpp"
+#include "buffer.hpp"
+#include "../user_settings.hpp"
+
+namespace tc {
+
+/* Settings that change what the hot loops of the renderer do.
+ * They are template parameters of the pipeline, so every combination
+ * compiles into its own branch-free specialization. */
+namespace render_feature {
+    const unsigned textures = 1u << 0;
+    const unsigned bad_normals = 1u << 1;
+    const unsigned dither = 1u << 2;
+    const unsigned n_combinations = 1u << 3;
+
+    // not a feature: marks the generic pipeline, which tests the settings at runtime
+    const unsigned runtime = 1u << 3;
+
+    inline unsigned from_settings() {
+        return (U.disable_textures ? 0u : textures)
+             | (U.bad_normals ? bad_normals : 0u)
+             | (U.dither && U.color_mode == color_mode::PALETTE256 ? dither : 0u);
+    }
+
+    template <unsigned features>
+    inline bool enabled(unsigned feature) {
+        if constexpr ((features & runtime) != 0) {
+            return (from_settings() & feature) != 0;
+        } else {
+            return (features & feature) != 0;
+        }
+    }
+} /* end of namespace render_feature */
+
+/* A render pipeline known at compile time: the shaders are template
+ * arguments (so they are inlined into the loops of Render) together with
+ * the enabled features. */
+template <void (*p_vert_shader)(vertex*, glm::mat4, glm::mat4, float),
+          glm::vec3 (*p_frag_shader)(fragment, glm::vec3, float, float),
+          glm::vec3 (*p_post_shader)(const buffer<glm::vec3>*, glm::ivec2, glm::ivec2, float),
+          unsigned p_features>
+struct pipeline {
+    static constexpr auto vert_shader = p_vert_shader;
+    static constexpr auto frag_shader = p_frag_shader;
+    static constexpr auto post_shader = p_post_shader;
+    static constexpr unsigned features = p_features;
+
+    static bool enabled(unsigned feature) {
+        return render_feature::enabled<features>(feature);
+    }
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: PIPELINE_HPP */
@@ -0,0 +1,148 @@
+#include "presenter.hpp"
+
+using namespace std;
+
+namespace tc {
+
+// public:
+
+Presenter::Presenter(shared_ptr<Frame_Sink> p_sink, bool p_threaded) : sink(p_sink), threaded(p_threaded) {
+    if (threaded) {
+        thread = std::thread(&Presenter::present_loop, this);
+    }
+}
+
+Presenter::~Presenter() {
+    stop();
+}
+
+frame &Presenter::back_frame() {
+    return frames[back];
+}
+
+/* Hands the back frame over to the presenter.
+ * Returns false if presenting this or (threaded) an earlier frame failed. */
+bool Presenter::submit() {
+    if (!threaded) {
+        bool success = present(frames[back]);
+        screen.get_stats(&frame_bytes, &encode_time);
+        return success;
+    }
+
+    lock_guard<std::mutex> lock {mutex};
+    swap(back, ready);
+    if (ready_pending) ++n_dropped; // the presenter never saw the old ready frame
+    ready_pending = true;
+    frame_ready.notify_one();
+    return !failed;
+}
+
+// stops the presenter thread, a frame that is still pending is dropped
+void Presenter::stop() {
+    if (!thread.joinable()) return;
+
+    {
+        lock_guard<std::mutex> lock {mutex};
+        should_stop = true;
+    }
+    frame_ready.notify_one();
+    thread.join();
+}
+
+void Presenter::get_stats(size_t *frame_bytes_ptr, float *encode_time_ptr, int *n_dropped_ptr) {
+    lock_guard<std::mutex> lock {mutex};
+    *frame_bytes_ptr = frame_bytes;
+    *encode_time_ptr = encode_time;
+    *n_dropped_ptr = n_dropped;
+}
+
+// private:
+
+void Presenter::present_loop() {
+    while (true) {
+        {
+            unique_lock<std::mutex> lock {mutex};
+            frame_ready.wait(lock, [this] {return ready_pending || should_stop;});
+            if (should_stop) return;
+            swap(front, ready);
+            ready_pending = false;
+        }
+
+        bool success = present(frames[front]);
+
+        lock_guard<std::mutex> lock {mutex};
+        if (!success) failed = true;
+        screen.get_stats(&frame_bytes, &encode_time);
+    }
+}
+
+bool Presenter::present(const frame &f) {
+    profiler::Scoped_Timer timer {"Presenter::present"};
+
+    if (sink->wants_pixels()) {
+        return sink->write_pixels(f.fbuf, f.X_res, f.Y_res);
+    }
+
+    cell_buf.clear(f.X_size, f.Y_size, cell {});
+
+    // the cell loop is specialized for the output mode, which doesn't change while running
+    const bool ascii = U.color_mode == color_mode::ASCII;
+    const bool halfblock = f.Y_res != f.Y_size;
+    if (ascii) {
+        if (U.debug_info) compose_cells<true, false, true>(f);
+        else compose_cells<true, false, false>(f);
+    } else if (halfblock) {
+        if (U.debug_info) compose_cells<false, true, true>(f);
+        else compose_cells<false, true, false>(f);
+    } else {
+        if (U.debug_info) compose_cells<false, false, true>(f);
+        else compose_cells<false, false, false>(f);
+    }
+
+    return screen.present(cell_buf, f.X_size, f.Y_size, sink.get());
+}
+
+template <bool ascii, bool halfblock, bool debug_info>
+void Presenter::compose_cells(const frame &f) {
+    const uint32_t debug_fg = draw_util::auto_color(glm::vec3(1.0f));
+
+    /* Serial: the grid is only terminal sized, and a thread team here
+     * would compete with the render thread's parallel regions. */
+    for (int x = 0; x < f.X_size; ++x) {
+        for (int y = 0; y < f.Y_size; ++y) {
+            cell &c = cell_buf.buf[x][y];
+
+            if (ascii) {
+                c.glyph = draw_util::ascii_bw_char(f.fbuf.buf[x][y]);
+            } else if (halfblock) {
+                c.bg = draw_util::auto_color(f.fbuf.buf[x][y*2 + 1]);
+                const uint32_t top = draw_util::auto_color(f.fbuf.buf[x][y*2]);
+                if (top != c.bg) {
+                    c.glyph = U'\u2580'; // upper half block
+                    c.fg = top;
+                }
+            } else {
+                c.bg = draw_util::auto_color(f.fbuf.buf[x][y]);
+            }
+
+            // debug info is drawn below the hud
+            cell hud = f.hud_buf.buf[x][y];
+            if (debug_info && hud.glyph == '\0' && f.debug_buf.buf[x][y] != ' ') {
+                hud = cell {static_cast<char32_t>(f.debug_buf.buf[x][y]), 0, debug_fg, cell_color::NONE};
+            }
+
+            // the hud is drawn on top, keeping the background if it has none
+            if (hud.glyph != '\0') {
+                if (halfblock && hud.bg == cell_color::NONE) {
+                    c.bg = draw_util::auto_color(glm::mix(f.fbuf.buf[x][y*2], f.fbuf.buf[x][y*2 + 1], 0.5f));
+                }
+                c.glyph = hud.glyph;
+                c.attr = hud.attr;
+                c.fg = hud.fg;
+                if (hud.bg != cell_color::NONE) c.bg = hud.bg;
+            }
+        }
+    }
+}
+
+} /* end of namespace tc */
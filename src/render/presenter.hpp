@@ -0,0 +1,87 @@
+#ifndef PRESENTER_HPP
+#define PRESENTER_HPP
+
+#include "../glm.hpp"
+
+#include "buffer.hpp"
+#include "cell.hpp"
+#include "draw_util.hpp"
+#include "screen.hpp"
+#include "frame_sink.hpp"
+#include "../user_settings.hpp"
+#include "../profiler.hpp"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <utility>
+#include <cstddef>
+
+namespace tc {
+
+// everything the presenter needs to turn a rendered frame into output
+struct frame {
+    int X_size = 0; // in cells
+    int Y_size = 0;
+    int X_res = 0; // in pixels
+    int Y_res = 0;
+    buffer<glm::vec3> fbuf;
+    buffer<cell> hud_buf;
+    buffer<char> debug_buf;
+};
+
+/* Composes finished frames into cells, encodes them and writes them to
+ * the sink. In threaded mode this happens on its own thread while the
+ * next frame is rendered: frames are triple-buffered (back: being
+ * filled by the renderer, ready: newest finished frame, front: being
+ * presented) and a ready frame that is replaced by a newer one before
+ * the presenter got to it is dropped instead of queued.
+ * Without a thread (headless), every frame is presented in submit(). */
+class Presenter {
+public:
+    Presenter(std::shared_ptr<Frame_Sink> p_sink, bool p_threaded);
+    ~Presenter();
+
+    Presenter(const Presenter&) = delete;
+    Presenter &operator=(const Presenter&) = delete;
+
+    frame &back_frame();
+    bool submit();
+    void stop();
+    void get_stats(size_t *frame_bytes_ptr, float *encode_time_ptr, int *n_dropped_ptr);
+
+private:
+    void present_loop();
+    bool present(const frame &f);
+    template <bool ascii, bool halfblock, bool debug_info>
+    void compose_cells(const frame &f);
+
+    std::shared_ptr<Frame_Sink> sink;
+    bool threaded;
+
+    frame frames[3];
+    int back = 0;
+    int ready = 1;
+    int front = 2;
+    bool ready_pending = false;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable frame_ready;
+    bool should_stop = false;
+    bool failed = false;
+
+    // only used by the presenting thread
+    buffer<cell> cell_buf;
+    Screen screen;
+
+    // stats (for debug info)
+    size_t frame_bytes = 0;
+    float encode_time = 0.0f;
+    int n_dropped = 0;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: PRESENTER_HPP */
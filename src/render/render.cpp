@@ -4,40 +4,102 @@ using namespace std;
 
 namespace tc {
 
+namespace {
+
+// fixed point precision of the rasterizer
+const int subpixel_bits = 4;
+const int subpixel_steps = 1 << subpixel_bits;
+
+// largest screen extent (in pixels) for which edge functions fit into 32 bits
+const int int32_safe_extent = 1000;
+
+// the nearest sections with at least this many triangles in total are occluders
+const int occluder_tri_budget = 8192;
+
+// cutout texels with at least this alpha are drawn (they are 0 or 1)
+const float cutout_alpha_threshold = 0.5f;
+
+// triangles per work item of the vertex stage, their vertices fill whole batches of the vertex stream
+const int vertex_work_tris = 336;
+static_assert(vertex_work_tris * 3 % vertex_stream::batch_size == 0, "vertex work items must start at a batch");
+
+int round_up_to_batch(int n_vertices) {
+    return (n_vertices + vertex_stream::batch_size - 1) / vertex_stream::batch_size * vertex_stream::batch_size;
+}
+
+const Texture_Set &get_texture_set(const tri &triangle) {
+    return block_type::get_block_texture(triangle.block_ptr->type);
+}
+
+/* Footprint of the triangle's texture on the screen, the same for the
+ * whole triangle: the ratio of its area in texture coordinates and in
+ * pixels (a texture of size 1 in both directions). */
+float tex_coord_lod(const tri &triangle) {
+    const glm::vec2 s1 = triangle.vertices[1].screenpos - triangle.vertices[0].screenpos;
+    const glm::vec2 s2 = triangle.vertices[2].screenpos - triangle.vertices[0].screenpos;
+    const glm::vec2 t1 = triangle.vertices[1].tex_coord - triangle.vertices[0].tex_coord;
+    const glm::vec2 t2 = triangle.vertices[2].tex_coord - triangle.vertices[0].tex_coord;
+
+    const float screen_area = std::abs(s1.x * s2.y - s1.y * s2.x);
+    const float tex_area = std::abs(t1.x * t2.y - t1.y * t2.x);
+    if (screen_area <= 0.0f || tex_area <= 0.0f) return 0.0f;
+    return 0.5f * std::log2(tex_area / screen_area);
+}
+
+} /* end of anonymous namespace */
+
 // public:
 
 Render::Render(int p_X_size, int p_Y_size) : X_size(p_X_size), Y_size(p_Y_size) {
+    select_pipeline();
+    update_resolution();
     clear_buffers();
 }
 
-void Render::render(mesh m) {
+bool Render::render(std::shared_ptr<const mesh> world_mesh) {
+    chrono::high_resolution_clock timer;
+    auto timer_start = timer.now();
+
     clear_buffers();
-    execute_vertex_shader(&m, vert_shaders::VERT_camera);
-    rasterize(&m);
-    execute_fragment_and_post_shaders(frag_shaders::FRAG_shaded, post_shaders::POST_vignette);
+    (this->*pipeline_fn)(world_mesh);
     if (!U.hide_hud) construct_hud();
-    draw_fbuf();
+    bool success = submit_frame();
+
+    auto timer_end = timer.now();
+    update_render_scale(chrono::duration_cast<chrono::microseconds>(timer_end - timer_start).count() / 1000.0f);
+
+    return success;
 }
 
 void Render::set_debug_info(std::string debug_info) {
     debug_buf.clear(X_size, Y_size, ' ');
 
+    // lines longer than the screen are cut off
     int x = 0, y = 0;
-    for (int i = 0; i < debug_info.length(); ++i) {
+    for (int i = 0; i < debug_info.length() && y < Y_size; ++i) {
         if (debug_info[i] == '\n') {
             ++y;
             x = 0;
         } else {
-            debug_buf.buf[x][y] = debug_info[i];
+            if (x < X_size) debug_buf.buf[x][y] = debug_info[i];
             ++x;
         }
-        if (x > X_size || y > Y_size) break;
     }
 }
 
+void Render::set_sink(std::shared_ptr<Frame_Sink> p_sink) {
+    // headless output must not drop frames, so it is presented synchronously
+    presenter = std::make_unique<Presenter>(p_sink, !U.headless);
+}
+
+void Render::stop_output() {
+    presenter->stop();
+}
+
 void Render::set_params(int p_X_size, int p_Y_size, float p_global_time, float p_time_of_day, glm::mat4 p_V, glm::mat4 p_VP, block_type::Block_Type p_active_block_type, bool p_flying, bool p_crouching, bool p_sprinting) {
     X_size = p_X_size;
     Y_size = p_Y_size;
+    update_resolution();
     global_time = p_global_time;
     time_of_day = p_time_of_day;
     time_of_day_update();
@@ -54,8 +116,104 @@ void Render::get_params(int *n_tris_ptr, int *n_active_tris_ptr) {
     *n_active_tris_ptr = n_active_tris;
 }
 
+void Render::get_culling_stats(int *n_sections_ptr, int *n_visible_sections_ptr, int *n_occluded_sections_ptr) {
+    *n_sections_ptr = n_sections;
+    *n_visible_sections_ptr = n_visible_sections;
+    *n_occluded_sections_ptr = n_occluded_sections;
+}
+
+void Render::get_render_scale(float *scale_ptr, int *X_res_ptr, int *Y_res_ptr) {
+    *scale_ptr = render_scale_levels[scale_level];
+    *X_res_ptr = X_res;
+    *Y_res_ptr = Y_res;
+}
+
+void Render::get_output_stats(size_t *frame_bytes_ptr, float *encode_time_ptr, int *n_dropped_ptr) {
+    presenter->get_stats(frame_bytes_ptr, encode_time_ptr, n_dropped_ptr);
+}
+
 // private:
 
+/* The settings don't change while running, so the pipeline is chosen once.
+ * Which specializations exist is a build option (TC_PIPELINE_VARIANTS),
+ * settings without one use the generic pipeline. */
+void Render::select_pipeline() {
+    const unsigned features = render_feature::from_settings();
+    pipeline_fn = &Render::run_pipeline<default_pipeline<render_feature::runtime>>;
+
+#if defined(TC_PIPELINE_VARIANTS_ALL)
+    static void (Render::*const variants[render_feature::n_combinations])(const std::shared_ptr<const mesh>&) = {
+        &Render::run_pipeline<default_pipeline<0>>,
+        &Render::run_pipeline<default_pipeline<1>>,
+        &Render::run_pipeline<default_pipeline<2>>,
+        &Render::run_pipeline<default_pipeline<3>>,
+        &Render::run_pipeline<default_pipeline<4>>,
+        &Render::run_pipeline<default_pipeline<5>>,
+        &Render::run_pipeline<default_pipeline<6>>,
+        &Render::run_pipeline<default_pipeline<7>>,
+    };
+    pipeline_fn = variants[features];
+#elif defined(TC_PIPELINE_VARIANTS_DEFAULT)
+    if (features == render_feature::textures) {
+        pipeline_fn = &Render::run_pipeline<default_pipeline<render_feature::textures>>;
+    }
+#endif
+}
+
+template <typename P>
+void Render::run_pipeline(const std::shared_ptr<const mesh> &world_mesh) {
+    execute_vertex_shader<P>(world_mesh);
+    bin_triangles(&frame_mesh);
+    rasterize_and_shade<P>(&frame_mesh);
+    execute_post_shader<P>();
+}
+
+void Render::update_resolution() {
+    // half-block modes pack two pixels into one cell: "▀" with fg = top, bg = bottom
+    const bool halfblock = U.color_mode == color_mode::HALFBLOCK || U.color_mode == color_mode::HALFBLOCK_COMPAT;
+    X_out_res = X_size;
+    Y_out_res = halfblock ? Y_size * 2 : Y_size;
+
+    // internal render resolution, upscaled to the output resolution afterwards
+    const float scale = render_scale_levels[scale_level];
+    X_res = max(static_cast<int>(X_out_res * scale + 0.5f), 1);
+    Y_res = max(static_cast<int>(Y_out_res * scale + 0.5f), 1);
+}
+
+/* Picks the render scale for the next frame from the time the last
+ * frames took (without the presenting, which runs on its own thread)
+ * compared to the frame time budget of the target fps. */
+void Render::update_render_scale(float frame_time) {
+    if (U.headless) return; // as fast as possible, there is no budget
+
+    const int n_levels = std::extent<decltype(render_scale_levels)>::value;
+    const int settle_frames = 12; // wait for the average to follow a change
+    const float budget = 1000.0f / U.fps;
+
+    smoothed_frame_time = glm::mix(smoothed_frame_time, frame_time, 0.2f);
+    if (++frames_since_scale_change < settle_frames) return;
+
+    int new_level = scale_level;
+    if (smoothed_frame_time > budget * 0.85f) {
+        if (scale_level + 1 < n_levels && render_scale_levels[scale_level + 1] >= U.min_render_scale - 0.001f) {
+            new_level = scale_level + 1;
+        }
+    } else if (scale_level > 0) {
+        // assume all the time scales with the pixel count (overestimates, so it doesn't oscillate)
+        const float ratio = render_scale_levels[scale_level - 1] / render_scale_levels[scale_level];
+        if (smoothed_frame_time * ratio * ratio < budget * 0.7f) {
+            new_level = scale_level - 1;
+        }
+    }
+
+    if (new_level != scale_level) {
+        const float ratio = render_scale_levels[new_level] / render_scale_levels[scale_level];
+        smoothed_frame_time *= ratio * ratio; // estimate until new measurements come in
+        scale_level = new_level;
+        frames_since_scale_change = 0;
+    }
+}
+
 void Render::time_of_day_update() {
     const float two_pi = 6.283185307f;
 
@@ -68,281 +226,766 @@ void Render::time_of_day_update() {
 }
 
 void Render::clear_buffers() {
-    fbuf.clear(X_size, Y_size, U.sky_color * sky_brightness);
-    frag_buf.clear(X_size, Y_size, list<fragment> {});
-    hud_buf.clear(X_size, Y_size, " ");
+    profiler::Scoped_Timer timer {"clear_buffers"};
+
+    fbuf.clear(X_res, Y_res, U.sky_color * sky_brightness);
+    frag_buf.clear(X_res, Y_res);
+    cell empty {};
+    empty.glyph = '\0';
+    hud_buf.clear(X_size, Y_size, empty);
     // NOT clearing debug_buf, already set by set_debug_info()
 }
 
-void Render::execute_vertex_shader(mesh *m, void (*vert_shader)(vertex*, glm::mat4, glm::mat4, float)) {
-    n_tris = m->tri_list.size(); // for debug info
+/* Reads the (immutable) world mesh and writes the triangles that are
+ * visible this frame into frame_mesh. */
+template <typename P>
+void Render::execute_vertex_shader(const std::shared_ptr<const mesh> &world_mesh) {
+    profiler::Scoped_Timer timer {"execute_vertex_shader"};
+
+    const std::vector<tri> &tri_list = world_mesh->tri_list;
+    n_tris = tri_list.size(); // for debug info
+
+    /* The camera shader runs on the vertex stream, many vertices at once
+     * (see vertex_stream.hpp); other vertex shaders run per vertex.
+     * Positions are only gathered into the stream when the world
+     * publishes a new mesh. */
+    constexpr bool batched = P::vert_shader == vert_shaders::VERT_camera;
+    if (world_mesh != stream_mesh) {
+        const int stream_size = update_stream_sections(*world_mesh);
+        if (batched) {
+            verts.resize(stream_size);
+            gather_positions(tri_list);
+        }
+        stream_mesh = world_mesh;
+    }
 
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < m->tri_list.size(); ++i) {
-        tri &triangle = m->tri_list[i];
-
-        for (vertex &v : triangle.vertices) {
-            // Programmable Shader
-            vert_shader(&v, V, VP, global_time);
-
-            /* Depth Division
-             * pre-divides w too so that we can simply multiply in perspective
-             * correction (for performance; following OpenGL spec)
-             *
-             * First, we make shure w isn't 0 or less, which is neccessary
-             * since we don't have proper triangle clipping. */
-            const float w_grad_start = -1.0f;
-            const float w_grad_end = 0.001f;
-            const float w_epsilon = 0.0001f;
-            if (v.pos.w < w_grad_start) {
-                v.pos.w = w_epsilon;
-            } else if (v.pos.w < w_grad_end) {
-                v.pos.w = ((v.pos.w - w_grad_start) / (w_grad_end - w_grad_start)) * (w_grad_end - w_epsilon) + w_epsilon;
-            }
+    frame_mesh.tri_list.clear();
 
-            v.pos = glm::vec4(v.pos.xyz(), 1.0f) / v.pos.w;
-        }
+    // without sections there is nothing to cull
+    const bool cull = !world_mesh->sections.empty();
+    collect_visible_sections(cull);
+
+    /* Occlusion Culling
+     * The nearest sections are the occluders: they are always processed,
+     * their opaque triangles are rasterized into the occlusion buffer and
+     * all other sections are tested against it. */
+    int n_occluder_sections = 0;
+    for (int occluder_tris = 0; n_occluder_sections < visible_sections.size() && occluder_tris < occluder_tri_budget; ++n_occluder_sections) {
+        const vertex_work &section = stream_sections[visible_sections[n_occluder_sections]];
+        occluder_tris += section.end - section.begin;
+    }
+    if (!cull) n_occluder_sections = visible_sections.size();
 
-        /* View Clipping and Backface Culling
-         * If the triangle doesn't touch NDC space
-         * or is facing away from the camera,
-         * it is marked for death. */
-        triangle.view_normal = triangle.calc_normal();
+    vertex_work_items.clear();
+    for (int i = 0; i < n_occluder_sections; ++i) add_vertex_work(visible_sections[i]);
+    run_vertex_work<P>(tri_list);
 
-        bool backfacing = glm::sign(triangle.view_normal.z) >= 0;
+    n_occluded_sections = 0;
+    if (n_occluder_sections < visible_sections.size()) {
+        build_occlusion_buffer<P>();
 
-        if (!draw_util::is_tri_in_NDC(triangle) ||
-            backfacing && !U.bad_normals && !block_type::block_transparent[triangle.block_ptr->type]) {
+        vertex_work_items.clear();
+        for (int i = n_occluder_sections; i < visible_sections.size(); ++i) {
+            if (is_section_occluded(visible_sections[i])) {
+                ++n_occluded_sections;
+                continue;
+            }
+            add_vertex_work(visible_sections[i]);
+        }
+        run_vertex_work<P>(tri_list);
+    }
 
-            triangle.marked_for_death = true;
+    n_active_tris = frame_mesh.tri_list.size(); // for debug info
+}
 
-        } else {
-            /* backfacing normal correction */
-            if (backfacing) {
-                triangle.world_normal *= -1.0f;
+/* Transforms and culls the triangles of vertex_work_items and appends
+ * the visible ones to frame_mesh (in the order of the work items).
+ * The view matrix is rigid, so the fog distance is the distance to
+ * the camera position. */
+template <typename P>
+void Render::run_vertex_work(const std::vector<tri> &tri_list) {
+    constexpr bool batched = P::vert_shader == vert_shaders::VERT_camera;
+    const stream_transform transform {VP, glm::vec3(glm::inverse(V)[3]), glm::vec2(X_res, Y_res)};
+
+    // output per thread (kept between frames), concatenated in thread order below
+    const int n_threads = omp_get_max_threads();
+    thread_tris.resize(n_threads);
+    for (std::vector<tri> &tris : thread_tris) tris.clear();
+
+    #pragma omp parallel
+    {
+        profiler::Scoped_Timer thread_timer {"execute_vertex_shader (thread)", true};
+        std::vector<tri> &out = thread_tris[omp_get_thread_num()];
+
+        // static schedule: every thread gets one contiguous range, in thread order
+        #pragma omp for schedule(static)
+        for (int w = 0; w < vertex_work_items.size(); ++w) {
+            const vertex_work &work = vertex_work_items[w];
+
+            if constexpr (batched) {
+                transform_vertices(&verts, transform, work.stream_begin, work.stream_begin + (work.end - work.begin) * 3);
             }
 
-            // screen transform
-            for (vertex &v : triangle.vertices) {
-                v.screenpos = v.pos.xy() * 0.5f + 0.5f;
-                v.screenpos.x *= X_size;
-                v.screenpos.y *= Y_size;
+            for (int i = work.begin; i < work.end; ++i) {
+                if constexpr (batched) {
+                    const int v = work.stream_begin + (i - work.begin) * 3;
+                    if (verts.near_dist[v] >= 0.0f && verts.near_dist[v + 1] >= 0.0f && verts.near_dist[v + 2] >= 0.0f) {
+                        // in front of the near plane and already projected
+                        emit_stream_tri<P>(v, tri_list[i], &out);
+                        continue;
+                    }
+                }
+
+                tri triangle = tri_list[i];
+                for (vertex &v : triangle.vertices) {
+                    // Programmable Shader
+                    P::vert_shader(&v, V, VP, global_time);
+                }
+
+                /* Near Plane Clipping
+                 * in clip space, before the depth division, so that w stays
+                 * positive and bounding boxes only cover what is visible.
+                 * A triangle is either culled, kept or split into two. */
+                tri clipped[2];
+                const int n_clipped = draw_util::clip_tri_near(triangle, clipped);
+
+                for (int k = 0; k < n_clipped; ++k) {
+                    project_tri<P>(&clipped[k]);
+                    if (!clipped[k].marked_for_death) out.push_back(clipped[k]);
+                }
             }
         }
     }
 
     /* View Clipping and Backface Culling
-     * build a new mesh without marked-for-death triangles
-     * (faster than erasing individually) */
-    mesh tmp;
-    for (int i = 0; i < m->tri_list.size(); ++i) {
-        if (!m->tri_list[i].marked_for_death) {
-            tmp.tri_list.push_back(m->tri_list[i]);
+     * the mesh of this frame only has the visible triangles */
+    for (const std::vector<tri> &tris : thread_tris) {
+        frame_mesh.tri_list.insert(frame_mesh.tri_list.end(), tris.begin(), tris.end());
+    }
+}
+
+// world positions of all triangles into the vertex stream (see update_stream_sections)
+void Render::gather_positions(const std::vector<tri> &tri_list) {
+    #pragma omp parallel for schedule(dynamic)
+    for (int s = 0; s < stream_sections.size(); ++s) {
+        const vertex_work &section = stream_sections[s];
+        for (int i = section.begin; i < section.end; ++i) {
+            for (int k = 0; k < 3; ++k) {
+                const int v = section.stream_begin + (i - section.begin) * 3 + k;
+                const glm::vec4 &pos = tri_list[i].vertices[k].pos;
+                verts.x[v] = pos.x;
+                verts.y[v] = pos.y;
+                verts.z[v] = pos.z;
+            }
+        }
+    }
+}
+
+/* Where the sections of a new world mesh are in the vertex stream:
+ * every section starts at a whole batch, so that pieces of different
+ * sections never share a batch. A mesh without sections is one section.
+ * Returns the size of the stream. */
+int Render::update_stream_sections(const mesh &world_mesh) {
+    stream_sections.clear();
+    section_bounds.clear();
+
+    int stream_size = 0;
+    auto add_section = [&](int begin, int end, glm::vec3 bb_min, glm::vec3 bb_max) {
+        stream_sections.push_back(vertex_work {begin, end, stream_size});
+        section_bounds.push_back(mesh_section {begin, end, bb_min, bb_max});
+        stream_size += round_up_to_batch((end - begin) * 3);
+    };
+
+    if (world_mesh.sections.empty()) {
+        if (!world_mesh.tri_list.empty()) add_section(0, world_mesh.tri_list.size(), glm::vec3(0.0f), glm::vec3(0.0f));
+    } else {
+        for (const mesh_section &section : world_mesh.sections) {
+            add_section(section.begin, section.end, section.bb_min, section.bb_max);
         }
     }
-    *m = tmp;
+    return stream_size;
+}
+
+/* Frustum Culling
+ * Sections whose bounding box touches the view frustum, nearest first
+ * (good occluders and fewer overdraw in the rasterizer). */
+void Render::collect_visible_sections(bool cull) {
+    glm::vec4 planes[6];
+    draw_util::frustum_planes(VP, planes);
+    const glm::vec3 camera_pos = glm::inverse(V)[3];
+
+    section_order.clear();
+    for (int s = 0; s < stream_sections.size(); ++s) {
+        const mesh_section &bounds = section_bounds[s];
+        if (cull && !draw_util::is_box_in_frustum(planes, bounds.bb_min, bounds.bb_max)) continue;
+
+        // distance from the camera to the closest point of the box
+        const glm::vec3 d = glm::max(glm::max(bounds.bb_min - camera_pos, camera_pos - bounds.bb_max), glm::vec3(0.0f));
+        section_order.push_back({glm::dot(d, d), s});
+    }
+    if (cull) std::sort(section_order.begin(), section_order.end());
+
+    visible_sections.clear();
+    for (const std::pair<float, int> &section : section_order) visible_sections.push_back(section.second);
+
+    n_sections = stream_sections.size();
+    n_visible_sections = visible_sections.size();
+}
+
+// the section's triangles as vertex work items of at most vertex_work_tris triangles
+void Render::add_vertex_work(int section_index) {
+    const vertex_work &section = stream_sections[section_index];
+    for (int begin = section.begin; begin < section.end; begin += vertex_work_tris) {
+        vertex_work_items.push_back(vertex_work {begin, std::min(begin + vertex_work_tris, section.end),
+                                                 section.stream_begin + (begin - section.begin) * 3});
+    }
+}
+
+// opaque triangles of frame_mesh (the occluder sections so far) into the occlusion buffer
+template <typename P>
+void Render::build_occlusion_buffer() {
+    profiler::Scoped_Timer timer {"build_occlusion_buffer"};
+
+    // sampled at the render resolution, the pyramid levels are the low resolution
+    occlusion_buf.clear(X_res, Y_res);
+
+    for (const tri &t : frame_mesh.tri_list) {
+        // by the texture: a block with see-through texels must not hide anything
+        if (get_material<P>(t) != material::OPAQUE) continue;
+
+        const float max_depth = std::max(std::max(t.vertices[0].pos.z, t.vertices[1].pos.z), t.vertices[2].pos.z);
+        occlusion_buf.insert_occluder(t.vertices[0].screenpos, t.vertices[1].screenpos, t.vertices[2].screenpos, max_depth);
+    }
+
+    occlusion_buf.build_pyramid();
+}
 
-    n_active_tris = m->tri_list.size(); // for debug info
+bool Render::is_section_occluded(int section_index) {
+    const mesh_section &bounds = section_bounds[section_index];
+
+    glm::vec3 ndc_min, ndc_max;
+    if (!draw_util::project_box(VP, bounds.bb_min, bounds.bb_max, &ndc_min, &ndc_max)) return false;
+
+    // same mapping as the screen transform
+    const glm::vec2 size {X_res, Y_res};
+    return occlusion_buf.is_occluded((glm::vec2(ndc_min) * 0.5f + 0.5f) * size, (glm::vec2(ndc_max) * 0.5f + 0.5f) * size, ndc_min.z);
 }
 
-void Render::rasterize(mesh *m) {
+// depth division and screen transform of a clipped triangle
+template <typename P>
+void Render::project_tri(tri *triangle) {
+    for (vertex &v : triangle->vertices) {
+        /* Depth Division
+         * pre-divides w too so that we can simply multiply in perspective
+         * correction (for performance; following OpenGL spec)
+         * w is at least the near distance after clipping. */
+        v.pos = glm::vec4(v.pos.xyz(), 1.0f) / v.pos.w;
+    }
+
+    if (cull_tri<P>(triangle)) {
+        // screen transform
+        for (vertex &v : triangle->vertices) {
+            v.screenpos = v.pos.xy() * 0.5f + 0.5f;
+            v.screenpos.x *= X_res;
+            v.screenpos.y *= Y_res;
+        }
+        if (P::enabled(render_feature::textures)) triangle->tex_lod = tex_coord_lod(*triangle);
+    }
+}
+
+/* cull_tri on the vertex stream, vertex v is the first one of source.
+ * Only triangles that stay are copied to out (the stream is read for all). */
+template <typename P>
+void Render::emit_stream_tri(int v, const tri &source, std::vector<tri> *out) {
+    const float *x = &verts.ndc_x[v];
+    const float *y = &verts.ndc_y[v];
+    const float *z = &verts.ndc_z[v];
+
+    // same test as draw_util::is_tri_in_NDC
+    const bool in_NDC =
+        (x[0] <  1 || x[1] <  1 || x[2] <  1) &&
+        (x[0] > -1 || x[1] > -1 || x[2] > -1) &&
+        (y[0] <  1 || y[1] <  1 || y[2] <  1) &&
+        (y[0] > -1 || y[1] > -1 || y[2] > -1) &&
+        (z[0] <  1 || z[1] <  1 || z[2] <  1) &&
+        (z[0] >  0 || z[1] >  0 || z[2] >  0);
+    if (!in_NDC) return;
+
+    // z of the view normal (see tri::calc_normal)
+    const bool backfacing = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]) >= 0.0f;
+    if (backfacing && !P::enabled(render_feature::bad_normals) && !keeps_backfaces<P>(source)) {
+        return;
+    }
+
+    out->push_back(source);
+    tri &triangle = out->back();
+    for (int k = 0; k < 3; ++k) {
+        vertex &vert = triangle.vertices[k];
+        vert.pos = glm::vec4(x[k], y[k], z[k], verts.inv_w[v + k]);
+        vert.screenpos = glm::vec2(verts.screen_x[v + k], verts.screen_y[v + k]);
+        vert.distance = verts.distance[v + k];
+    }
+    triangle.view_normal = triangle.calc_normal();
+    if (P::enabled(render_feature::textures)) triangle.tex_lod = tex_coord_lod(triangle);
+
+    /* backfacing normal correction */
+    if (backfacing) {
+        triangle.world_normal *= -1.0f;
+    }
+}
+
+// view clipping and backface culling of a projected triangle, returns false if it was culled
+template <typename P>
+bool Render::cull_tri(tri *triangle) {
+    /* View Clipping and Backface Culling
+     * If the triangle doesn't touch NDC space
+     * or is facing away from the camera,
+     * it is marked for death. */
+    triangle->view_normal = triangle->calc_normal();
+
+    bool backfacing = glm::sign(triangle->view_normal.z) >= 0;
+
+    if (!draw_util::is_tri_in_NDC(*triangle) ||
+        backfacing && !P::enabled(render_feature::bad_normals) && !keeps_backfaces<P>(*triangle)) {
+
+        triangle->marked_for_death = true;
+        return false;
+    }
+
+    /* backfacing normal correction */
+    if (backfacing) {
+        triangle->world_normal *= -1.0f;
+    }
+    return true;
+}
+
+void Render::bin_triangles(mesh *m) {
+    profiler::Scoped_Timer timer {"bin_triangles"};
+
+    n_tiles_x = (X_res + tile_size::width - 1) / tile_size::width;
+    n_tiles_y = (Y_res + tile_size::height - 1) / tile_size::height;
+    const int n_tiles = n_tiles_x * n_tiles_y;
+
+    // bins are kept between frames, clear() keeps their capacity
+    const int n_threads = omp_get_max_threads();
+    thread_bins.resize(n_threads);
+    for (std::vector<std::vector<int>> &bins : thread_bins) {
+        bins.resize(n_tiles);
+        for (std::vector<int> &bin : bins) bin.clear();
+    }
+    tile_bins.resize(n_tiles);
+    tri_setups.resize(m->tri_list.size());
+
+    // every thread bins its share of the triangles into its own bins
+    #pragma omp parallel
+    {
+        std::vector<std::vector<int>> &bins = thread_bins[omp_get_thread_num()];
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < m->tri_list.size(); ++i) {
+            if (!setup_tri(m->tri_list[i], &tri_setups[i])) continue;
+
+            const glm::ivec2 rect_min = tri_setups[i].bb_min;
+            const glm::ivec2 rect_max = tri_setups[i].bb_max;
+            const int tile_x_end = (rect_max.x - 1) / tile_size::width;
+            const int tile_y_end = (rect_max.y - 1) / tile_size::height;
+            for (int tile_x = rect_min.x / tile_size::width; tile_x <= tile_x_end; ++tile_x) {
+                for (int tile_y = rect_min.y / tile_size::height; tile_y <= tile_y_end; ++tile_y) {
+                    bins[tile_x * n_tiles_y + tile_y].push_back(i);
+                }
+            }
+        }
+    }
+
+    /* Merging: every tile is filled by one thread, in thread order
+     * (which keeps the triangle order of the mesh), so no locks are needed. */
     #pragma omp parallel for schedule(static)
-    for (tri &triangle : m->tri_list) {
-
-        // find bounding box
-        int min_x = max(min(min(triangle.vertices[0].screenpos.x,
-                                triangle.vertices[1].screenpos.x),
-                            triangle.vertices[2].screenpos.x),
-                        0.0f);
-        int max_x = min(max(max(triangle.vertices[0].screenpos.x,
-                                triangle.vertices[1].screenpos.x),
-                            triangle.vertices[2].screenpos.x),
-                        static_cast<float>(X_size));
-        int min_y = max(min(min(triangle.vertices[0].screenpos.y,
-                                triangle.vertices[1].screenpos.y),
-                            triangle.vertices[2].screenpos.y),
-                        0.0f);
-        int max_y = min(max(max(triangle.vertices[0].screenpos.y,
-                                triangle.vertices[1].screenpos.y),
-                            triangle.vertices[2].screenpos.y),
-                        static_cast<float>(Y_size));
-
-        // integer coordinates
-        glm::ivec2 p0 = triangle.vertices[0].screenpos;
-        glm::ivec2 p1 = triangle.vertices[1].screenpos;
-        glm::ivec2 p2 = triangle.vertices[2].screenpos;
-
-        /* pre-calculate area for barycentric coordinates
-         * reference: https://ceng2.ktu.edu.tr/~cakir/files/grafikler/Texture_Mapping.pdf */
-        float area = draw_util::cc_signed_area(p0, p1, p2);
-
-        // iterate through pixels
-        for (int x = min_x; x < max_x; ++x) {
-            for (int y = min_y; y < max_y; ++y) {
-                glm::ivec2 p {x, y};
-
-                /* calculate barycentric coordinates
-                 * reference: https://ceng2.ktu.edu.tr/~cakir/files/grafikler/Texture_Mapping.pdf */
-                float u = draw_util::cc_signed_area(p, p1, p2) / area;
-                float v = draw_util::cc_signed_area(p, p2, p0) / area;
-                /* This method doesn't work well for some reason:
-                 *  float w = 1.0f - u - v;
-                 * Therefore we calculate it with the standard approach: */
-                float w = draw_util::cc_signed_area(p, p0, p1) / area;
-
-                /* perspective-corrected barycentric coordinates
-                 * reference: https://stackoverflow.com/questions/24441631/how-exactly-does-opengl-do-perspectively-correct-linear-interpolation */
-                float b0 = u * triangle.vertices[0].pos.w;
-                float b1 = v * triangle.vertices[1].pos.w;
-                float b2 = w * triangle.vertices[2].pos.w;
-                float inv_b_sum = 1.0f / (b0 + b1 + b2);
-                b0 *= inv_b_sum;
-                b1 *= inv_b_sum;
-                b2 *= inv_b_sum;
-
-                /* checking if point is inside triangle */
-                if (b0 >= 0 && b1 >= 0 && b2 >= 0) {
-                    // interpolate depth
-                    float z = b0 * triangle.vertices[0].pos.z
-                            + b1 * triangle.vertices[1].pos.z
-                            + b2 * triangle.vertices[2].pos.z;
-
-                    // interpolate alpha
-                    const Texture_Set *tex_set = ((int)triangle.block_ptr->type < 0 ||
-                                                  (int)triangle.block_ptr->type >= std::extent<decltype(block_type::block_texture)>::value) ?
-                                                  &block_type::block_texture[0] :
-                                                  &block_type::block_texture[triangle.block_ptr->type];
-                    float a = U.disable_textures ?
-                              1.0f :
-                              tex_set->sample(b0 * triangle.vertices[0].tex_coord
-                                            + b1 * triangle.vertices[1].tex_coord
-                                            + b2 * triangle.vertices[2].tex_coord,
-                                              triangle.block_side_index).a;
-
-                    // create fragment if depth test passes
-                    #pragma omp critical
-                    {
-                        auto ins_point = frag_buf.buf[x][y].begin();
-                        auto i = frag_buf.buf[x][y].begin();
-                        while (i != frag_buf.buf[x][y].end()) {
-                            if (z < (*i).depth) {
-                                ins_point = i;
-                                break;
-                            }
-                            else if (i == std::prev(frag_buf.buf[x][y].end())) {
-                                ins_point = frag_buf.buf[x][y].end();
-                                break;
-                            }
-                            ++i;
-                        }
-                        i = frag_buf.buf[x][y].begin();
-                        bool occluded = false;
-                        while (i != ins_point) {
-                            if ((*i).opacity == 1.0f) {
-                                occluded = true;
-                                break;
-                            }
-                            ++i;
-                        }
-                        if (!occluded) {
-                            auto end = frag_buf.buf[x][y].emplace(ins_point, &triangle, b0, b1, b2, z, a);
-                            if (a == 1.0f) {
-                                frag_buf.buf[x][y].erase(ins_point, frag_buf.buf[x][y].end());
-                            }
-                        }
-                    }
+    for (int tile = 0; tile < n_tiles; ++tile) {
+        std::vector<int> &bin = tile_bins[tile];
+        bin.clear();
+        for (int t = 0; t < n_threads; ++t) {
+            bin.insert(bin.end(), thread_bins[t][tile].begin(), thread_bins[t][tile].end());
+        }
+    }
+}
+
+template <typename P>
+void Render::rasterize_and_shade(mesh *m) {
+    profiler::Scoped_Timer timer {"rasterize_and_shade"};
+
+    /* The rasterizer only writes the visibility buffer, a tile is
+     * shaded once all of its triangles are rasterized. */
+
+    /* Each thread owns whole tiles, so all writes to a tile's
+     * fragments and pixels come from one thread without synchronization. */
+    #pragma omp parallel
+    {
+        profiler::Scoped_Timer thread_timer {"rasterize_and_shade (thread)", true};
+
+        #pragma omp for schedule(dynamic)
+        for (int tile = 0; tile < n_tiles_x * n_tiles_y; ++tile) {
+            const glm::ivec2 tile_min {(tile / n_tiles_y) * tile_size::width, (tile % n_tiles_y) * tile_size::height};
+            const glm::ivec2 tile_max = glm::min(tile_min + glm::ivec2(tile_size::width, tile_size::height),
+                                                 glm::ivec2(X_res, Y_res));
+
+            for (int i : tile_bins[tile]) {
+                const tri &triangle = m->tri_list[i];
+                const raster_setup &setup = tri_setups[i];
+                const glm::ivec2 rect_min = glm::max(setup.bb_min, tile_min);
+                const glm::ivec2 rect_max = glm::min(setup.bb_max, tile_max);
+                switch (get_material<P>(triangle)) {
+                    case material::OPAQUE:
+                        rasterize_tri<P, material::OPAQUE>(triangle, i, setup, rect_min, rect_max);
+                        break;
+                    case material::CUTOUT:
+                        rasterize_tri<P, material::CUTOUT>(triangle, i, setup, rect_min, rect_max);
+                        break;
+                    case material::TRANSLUCENT:
+                        rasterize_tri<P, material::TRANSLUCENT>(triangle, i, setup, rect_min, rect_max);
+                        break;
                 }
             }
+
+            resolve_tile<P>(m, tile_min, tile_max);
         }
     }
 }
 
-void Render::execute_fragment_and_post_shaders(glm::vec3 (*frag_shader)(fragment, glm::vec3, float, float),
-                                               glm::vec3 (*post_shader)(const buffer<glm::vec3>*, glm::ivec2, glm::ivec2, float)) {
-    #pragma omp parallel for schedule(static) collapse(2)
-    for (int x = 0; x < X_size; ++x) {
-        for (int y = 0; y < Y_size; ++y) {
+/* Shading of the visibility buffer: material, texture and lighting
+ * once per visible record (the opaque one and translucent layers in
+ * front of it), back to front. */
+template <typename P>
+void Render::resolve_tile(mesh *m, glm::ivec2 tile_min, glm::ivec2 tile_max) {
+    auto to_fragment = [m](const vis_record &vis, float opacity) {
+        return fragment {&m->tri_list[vis.tri_index], 1.0f - vis.b1 - vis.b2, vis.b1, vis.b2, vis.depth, opacity};
+    };
+
+    for (int x = tile_min.x; x < tile_max.x; ++x) {
+        for (int y = tile_min.y; y < tile_max.y; ++y) {
             // Programmable Fragment Shader
-            for (auto i = frag_buf.buf[x][y].rbegin(); i != frag_buf.buf[x][y].rend(); ++i) {
-                fbuf.buf[x][y] = glm::mix(fbuf.buf[x][y], frag_shader((*i), sun_direction, sky_brightness, global_time), (*i).opacity);
+            const vis_record *opaque = frag_buf.get_opaque(x, y);
+            if (opaque) {
+                fbuf.buf[x][y] = P::frag_shader(to_fragment(*opaque, 1.0f), sun_direction, sky_brightness, global_time);
+            }
+
+            int n_layers;
+            const layer_record *layers = frag_buf.get_layers(x, y, &n_layers);
+            for (int i = n_layers - 1; i >= 0; --i) {
+                fbuf.buf[x][y] = glm::mix(fbuf.buf[x][y], P::frag_shader(to_fragment(layers[i].vis, layers[i].opacity), sun_direction, sky_brightness, global_time), layers[i].opacity);
+            }
+        }
+    }
+}
+
+/* Per-triangle setup of the rasterizer (once per frame, shared by all tiles):
+ * Half-space rasterization with edge functions in fixed point
+ * (subpixel_steps per pixel), sampled at pixel centers.
+ * The top-left fill rule makes sure that pixels on an edge shared by two
+ * triangles are drawn exactly once (no gaps and no overlaps).
+ * reference: https://fgiesen.wordpress.com/2013/02/08/triangle-rasterization-in-practice/
+ * Returns false if the triangle covers no pixels. */
+bool Render::setup_tri(const tri &triangle, raster_setup *setup_ptr) {
+    raster_setup &setup = *setup_ptr;
+
+    const glm::vec2 &p0 = triangle.vertices[0].screenpos;
+    const glm::vec2 &p1 = triangle.vertices[1].screenpos;
+    const glm::vec2 &p2 = triangle.vertices[2].screenpos;
+
+    // pixel bounding box (max exclusive), clamped in float first, the vertices can be far outside of the screen
+    // (after clamping to >= 0, truncation is floor)
+    const glm::vec2 bb_min = glm::clamp(glm::min(glm::min(p0, p1), p2), glm::vec2(0.0f), glm::vec2(X_res, Y_res));
+    const glm::vec2 bb_max = glm::clamp(glm::max(glm::max(p0, p1), p2), glm::vec2(0.0f), glm::vec2(X_res, Y_res));
+    setup.bb_min = bb_min;
+    setup.bb_max = bb_max;
+    if (setup.bb_max.x < bb_max.x) ++setup.bb_max.x; // ceil
+    if (setup.bb_max.y < bb_max.y) ++setup.bb_max.y;
+    if (setup.bb_min.x >= setup.bb_max.x || setup.bb_min.y >= setup.bb_max.y) return false;
+
+    // snap to subpixels (rounding half away from zero, cheaper than llround)
+    int64_t v[3][2];
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec2 p = triangle.vertices[i].screenpos * static_cast<float>(subpixel_steps);
+        v[i][0] = static_cast<int64_t>(p.x + (p.x < 0.0f ? -0.5f : 0.5f));
+        v[i][1] = static_cast<int64_t>(p.y + (p.y < 0.0f ? -0.5f : 0.5f));
+    }
+
+    // vertex order with positive area, so that the inside is where all edge functions are >= 0
+    int *order = setup.order;
+    order[0] = 0;
+    order[1] = 1;
+    order[2] = 2;
+    int64_t area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+    if (area == 0) return false;
+    if (area < 0) {
+        swap(order[1], order[2]);
+        area = -area;
+    }
+    setup.inv_area = 1.0f / static_cast<float>(area);
+
+    /* E(p) = A * p.x + B * p.y + C, edge k is opposite of vertex order[k]
+     * and its value divided by the area is that vertex' barycentric weight. */
+    for (int k = 0; k < 3; ++k) {
+        const int64_t *a = v[order[(k + 1) % 3]];
+        const int64_t *b = v[order[(k + 2) % 3]];
+        setup.A[k] = a[1] - b[1];
+        setup.B[k] = b[0] - a[0];
+        setup.C[k] = -(setup.A[k] * a[0] + setup.B[k] * a[1]);
+        // top-left rule: pixels exactly on an edge only belong to top and left edges
+        setup.bias[k] = (setup.A[k] > 0 || (setup.A[k] == 0 && setup.B[k] < 0)) ? 0 : -1;
+    }
+
+    /* 32 bit SIMD lanes are used if no value can overflow:
+     * |A|, |B| and |p - vertex| stay below 2^15, so |E| < 2^31. */
+    const int64_t max_coord = int32_safe_extent * subpixel_steps;
+    setup.fits_int32 = X_res <= int32_safe_extent && Y_res <= int32_safe_extent;
+    for (int i = 0; i < 3; ++i) {
+        setup.fits_int32 = setup.fits_int32 && llabs(v[i][0]) < max_coord && llabs(v[i][1]) < max_coord;
+    }
+
+    return true;
+}
+
+// without textures everything is opaque
+template <typename P>
+material::Material_Class Render::get_material(const tri &triangle) {
+    if (!P::enabled(render_feature::textures)) return material::OPAQUE;
+    return get_texture_set(triangle).get_material();
+}
+
+/* Back faces are visible through see-through texels (by the material
+ * class of the texture) and on single planes like flowers. */
+template <typename P>
+bool Render::keeps_backfaces(const tri &triangle) {
+    return get_material<P>(triangle) != material::OPAQUE ||
+           block_type::block_shape[triangle.block_ptr->type] != block_type::SOLID_BLOCK;
+}
+
+/* Specialized for the material class M of the triangle's texture:
+ * opaque triangles only test depth, cutouts also test alpha
+ * and only translucent ones are blended in the layers. */
+template <typename P, material::Material_Class M>
+void Render::rasterize_tri(const tri &triangle, uint32_t tri_index, const raster_setup &setup, glm::ivec2 rect_min, glm::ivec2 rect_max) {
+    const int *order = setup.order;
+    const Texture_Set *tex_set = M == material::OPAQUE ? nullptr : &get_texture_set(triangle);
+
+    // per covered pixel: weights from the (unbiased) edge values
+    auto emit_fragment = [&](int x, int y, const int64_t *e) {
+        float weights[3];
+        for (int k = 0; k < 3; ++k) {
+            weights[order[k]] = static_cast<float>(e[k] - setup.bias[k]) * setup.inv_area;
+        }
+
+        /* perspective-corrected barycentric coordinates
+         * reference: https://stackoverflow.com/questions/24441631/how-exactly-does-opengl-do-perspectively-correct-linear-interpolation */
+        float b0 = weights[0] * triangle.vertices[0].pos.w;
+        float b1 = weights[1] * triangle.vertices[1].pos.w;
+        float b2 = weights[2] * triangle.vertices[2].pos.w;
+        float inv_b_sum = 1.0f / (b0 + b1 + b2);
+        b0 *= inv_b_sum;
+        b1 *= inv_b_sum;
+        b2 *= inv_b_sum;
+
+        // interpolate depth
+        float z = b0 * triangle.vertices[0].pos.z
+                + b1 * triangle.vertices[1].pos.z
+                + b2 * triangle.vertices[2].pos.z;
+
+        // early depth rejection, overdraw costs nothing more than this
+        if (z >= frag_buf.get_depth(x, y)) return;
+
+        if constexpr (M == material::OPAQUE) {
+            frag_buf.insert_opaque(x, y, vis_record {tri_index, z, b1, b2});
+        } else {
+            // on the full resolution so that the shapes stay sharp
+            const float a = tex_set->sample(b0 * triangle.vertices[0].tex_coord
+                                          + b1 * triangle.vertices[1].tex_coord
+                                          + b2 * triangle.vertices[2].tex_coord,
+                                            triangle.block_side_index).a;
+
+            if constexpr (M == material::CUTOUT) {
+                if (a >= cutout_alpha_threshold) frag_buf.insert_opaque(x, y, vis_record {tri_index, z, b1, b2});
+            } else {
+                // fully transparent texels don't contribute anything
+                if (a > 0.0f) frag_buf.insert(x, y, vis_record {tri_index, z, b1, b2}, a);
+            }
+        }
+    };
+
+    // edge values at the center of the first pixel of the rectangle, and steps per pixel
+    const int64_t p0_x = static_cast<int64_t>(rect_min.x) * subpixel_steps + subpixel_steps / 2;
+    const int64_t p0_y = static_cast<int64_t>(rect_min.y) * subpixel_steps + subpixel_steps / 2;
+    int64_t e_start[3], step_x[3], step_y[3];
+    for (int k = 0; k < 3; ++k) {
+        e_start[k] = setup.A[k] * p0_x + setup.B[k] * p0_y + setup.C[k] + setup.bias[k];
+        step_x[k] = setup.A[k] * subpixel_steps;
+        step_y[k] = setup.B[k] * subpixel_steps;
+    }
+
+#ifdef __SSE2__
+    // 4 pixels of a column at a time (columns are contiguous in memory)
+    if (setup.fits_int32) {
+        __m128i lane_step[3], block_step[3];
+        for (int k = 0; k < 3; ++k) {
+            const int32_t s = static_cast<int32_t>(step_y[k]);
+            lane_step[k] = _mm_setr_epi32(0, s, 2 * s, 3 * s);
+            block_step[k] = _mm_set1_epi32(4 * s);
+        }
+
+        int64_t e_column[3] = {e_start[0], e_start[1], e_start[2]};
+        for (int x = rect_min.x; x < rect_max.x; ++x) {
+            __m128i e0 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(e_column[0])), lane_step[0]);
+            __m128i e1 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(e_column[1])), lane_step[1]);
+            __m128i e2 = _mm_add_epi32(_mm_set1_epi32(static_cast<int32_t>(e_column[2])), lane_step[2]);
+
+            for (int y = rect_min.y; y < rect_max.y; y += 4) {
+                // sign bit set: outside of at least one edge
+                const __m128i any_negative = _mm_or_si128(_mm_or_si128(e0, e1), e2);
+                int covered = ~_mm_movemask_ps(_mm_castsi128_ps(any_negative)) & 0xf;
+                if (rect_max.y - y < 4) covered &= (1 << (rect_max.y - y)) - 1;
+
+                if (covered) {
+                    alignas(16) int32_t lanes[3][4];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[0]), e0);
+                    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[1]), e1);
+                    _mm_store_si128(reinterpret_cast<__m128i*>(lanes[2]), e2);
+
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if (!(covered & (1 << lane))) continue;
+                        const int64_t e[3] = {lanes[0][lane], lanes[1][lane], lanes[2][lane]};
+                        emit_fragment(x, y + lane, e);
+                    }
+                }
+
+                e0 = _mm_add_epi32(e0, block_step[0]);
+                e1 = _mm_add_epi32(e1, block_step[1]);
+                e2 = _mm_add_epi32(e2, block_step[2]);
             }
 
-            // Programmable Post Processing Shader
-            fbuf.buf[x][y] = post_shader(&fbuf, {x, y}, {X_size, Y_size}, global_time);
+            for (int k = 0; k < 3; ++k) e_column[k] += step_x[k];
+        }
+        return;
+    }
+#endif
+
+    // scalar (and for huge triangles 64 bit) fallback
+    int64_t e_column[3] = {e_start[0], e_start[1], e_start[2]};
+    for (int x = rect_min.x; x < rect_max.x; ++x) {
+        int64_t e[3] = {e_column[0], e_column[1], e_column[2]};
+        for (int y = rect_min.y; y < rect_max.y; ++y) {
+            if ((e[0] | e[1] | e[2]) >= 0) emit_fragment(x, y, e);
+            for (int k = 0; k < 3; ++k) e[k] += step_y[k];
+        }
+        for (int k = 0; k < 3; ++k) e_column[k] += step_x[k];
+    }
+}
+
+template <typename P>
+void Render::execute_post_shader() {
+    profiler::Scoped_Timer timer {"execute_post_shader"};
+
+    // ordered dithering before quantizing to the palette (after upscaling, if scaled)
+    const bool dither = P::enabled(render_feature::dither) && X_res == X_out_res && Y_res == Y_out_res;
+
+    /* A separate pass after all tiles are shaded,
+     * post shaders may read neighboring pixels. */
+    #pragma omp parallel
+    {
+        profiler::Scoped_Timer thread_timer {"execute_post_shader (thread)", true};
+
+        #pragma omp for schedule(static)
+        for (int x = 0; x < X_res; ++x) {
+            for (int y = 0; y < Y_res; ++y) {
+                // Programmable Post Processing Shader
+                fbuf.buf[x][y] = P::post_shader(&fbuf, {x, y}, {X_res, Y_res}, global_time);
 
-            // debug info
-            if (U.debug_info) {
-                if (debug_buf.buf[x][y] != ' ') {
-                    hud_buf.buf[x][y] = string{}
-                                        .append(draw_util::auto_color_string(draw_util::FG, glm::vec3(1.0f)))
-                                        .append(string {debug_buf.buf[x][y]});
+                if (dither) {
+                    fbuf.buf[x][y] = draw_util::bayer_dither(fbuf.buf[x][y], {x, y});
                 }
             }
         }
     }
 }
 
+// fbuf (render resolution) into a buffer at the output resolution
+void Render::upscale_fbuf(buffer<glm::vec3> *out_ptr) {
+    profiler::Scoped_Timer timer {"upscale_fbuf"};
+
+    buffer<glm::vec3> &out = *out_ptr;
+    out.clear(X_out_res, Y_out_res, glm::vec3 {});
+
+    const glm::vec2 step {static_cast<float>(X_res) / X_out_res, static_cast<float>(Y_res) / Y_out_res};
+    const bool dither = (render_feature::from_settings() & render_feature::dither) != 0;
+
+    #pragma omp parallel for schedule(static)
+    for (int x = 0; x < X_out_res; ++x) {
+        for (int y = 0; y < Y_out_res; ++y) {
+            // bilinear, with pixel centers at +0.5
+            const glm::vec2 p = glm::clamp((glm::vec2(x, y) + 0.5f) * step - 0.5f,
+                                           glm::vec2(0.0f), glm::vec2(X_res - 1, Y_res - 1));
+            const glm::ivec2 p0 = p;
+            const glm::ivec2 p1 = glm::min(p0 + 1, glm::ivec2(X_res - 1, Y_res - 1));
+            const glm::vec2 f = p - glm::vec2(p0);
+
+            glm::vec3 c = glm::mix(glm::mix(fbuf.buf[p0.x][p0.y], fbuf.buf[p1.x][p0.y], f.x),
+                                   glm::mix(fbuf.buf[p0.x][p1.y], fbuf.buf[p1.x][p1.y], f.x),
+                                   f.y);
+
+            if (dither) {
+                c = draw_util::bayer_dither(c, {x, y});
+            }
+
+            out.buf[x][y] = c;
+        }
+    }
+}
+
 void Render::construct_hud() {
+    profiler::Scoped_Timer timer {"construct_hud"};
+
     const int offset = 3; // must be at least 2
 
+    const uint32_t white = draw_util::auto_color(glm::vec3(1.0f));
+    const uint32_t black = draw_util::auto_color(glm::vec3(0.0f));
+
     // crosshair
-    hud_buf.buf[X_size / 2][Y_size / 2] = string{}
-                        .append(draw_util::auto_color_string(draw_util::FG, glm::vec3(1.0f)))
-                        .append("\x1b[1m+");
+    hud_buf.buf[X_size / 2][Y_size / 2] = cell {'+', cell_attr::BOLD, white, cell_color::NONE};
 
     // block selector
     for (int i = 1; i < std::extent<decltype(block_type::block_color)>::value && Y_size - offset - i >= 0; ++i) {
-        std::string font_style = string {"\x1b[1"}
-                                 .append((i == active_block_type) ? ";7m" : "m")
-                                 .append(draw_util::auto_color_string(draw_util::FG,  glm::vec3(1.0f)));
-        std::string middle_part = string{}
-                                  .append(U.color_mode == "ASCII" ?
-                                      string {block_type::block_initial[i]} :
-                                      draw_util::auto_color_string(draw_util::BG, block_type::block_color[i]).append(" ")
-                                  )
-                                  .append(draw_util::ansi_clear_string());
-        hud_buf.buf[0][Y_size - offset - i] = string{}
-                                            .append(font_style)
-                                            .append(to_string(i));
-        hud_buf.buf[1][Y_size - offset - i] = string{}
-                                            .append(font_style)
-                                            .append("[");
+        unsigned char font_style = cell_attr::BOLD | ((i == active_block_type) ? cell_attr::REVERSE : 0);
+        cell middle_part = U.color_mode == color_mode::ASCII ?
+                           cell {static_cast<char32_t>(block_type::block_initial[i]), 0, cell_color::NONE, cell_color::NONE} :
+                           cell {' ', 0, cell_color::NONE, draw_util::auto_color(block_type::block_color[i])};
+
+        hud_buf.buf[0][Y_size - offset - i] = cell {static_cast<char32_t>('0' + i), font_style, white, cell_color::NONE};
+        hud_buf.buf[1][Y_size - offset - i] = cell {'[', font_style, white, cell_color::NONE};
         hud_buf.buf[2][Y_size - offset - i] = middle_part;
         hud_buf.buf[3][Y_size - offset - i] = middle_part;
-        hud_buf.buf[4][Y_size - offset - i] = string{}
-                                            .append(font_style)
-                                            .append("]");
+        hud_buf.buf[4][Y_size - offset - i] = cell {']', font_style, white, cell_color::NONE};
     }
 
     // controller state indicators
-    string indicator_style = string{}
-                             .append(draw_util::auto_color_string(draw_util::FG, glm::vec3(0.0f)))
-                             .append(draw_util::auto_color_string(draw_util::BG, glm::vec3(1.0f)))
-                             .append("\x1b[1m");
-    if (flying)    hud_buf.buf[0][Y_size - offset + 1] = string {indicator_style}.append("X");
-    if (crouching) hud_buf.buf[1][Y_size - offset + 1] = string {indicator_style}.append("C");
-    if (sprinting) hud_buf.buf[2][Y_size - offset + 1] = string {indicator_style}.append("P");
-}
-
-void Render::draw_fbuf() {
-    string printbuf = "";
-
-    for (size_t y = 0; y < Y_size; y++) {
-        if(y) printbuf.append("\n");
-        for (size_t x = 0; x < X_size; x++) {
-            if (U.color_mode == "ASCII") {
-                if (hud_buf.buf[x][y] == " ") printbuf.append(draw_util::ascii_bw_color_string(draw_util::BG, fbuf.buf[x][y]));
-                else printbuf.append(hud_buf.buf[x][y]);
-            } else {
-                printbuf.append(draw_util::auto_color_string(draw_util::BG, fbuf.buf[x][y]));
-                printbuf.append(hud_buf.buf[x][y]);
-            }
-            printbuf.append(draw_util::ansi_clear_string());
-        }
-    }
+    if (flying)    hud_buf.buf[0][Y_size - offset + 1] = cell {'X', cell_attr::BOLD, black, white};
+    if (crouching) hud_buf.buf[1][Y_size - offset + 1] = cell {'C', cell_attr::BOLD, black, white};
+    if (sprinting) hud_buf.buf[2][Y_size - offset + 1] = cell {'P', cell_attr::BOLD, black, white};
+}
 
-    printf("%s", printbuf.c_str());
-    fflush(stdout);
+bool Render::submit_frame() {
+    /* The finished buffers are swapped (not copied) into the presenter's
+     * back frame, this frame then starts with the stale ones and clears them.
+     * At a lower render scale fbuf is upscaled into the frame instead, so
+     * both keep their size (no reallocation) from frame to frame. */
+    frame &f = presenter->back_frame();
+    f.X_size = X_size;
+    f.Y_size = Y_size;
+    f.X_res = X_out_res;
+    f.Y_res = Y_out_res;
+    if (X_res != X_out_res || Y_res != Y_out_res) upscale_fbuf(&f.fbuf);
+    else std::swap(f.fbuf, fbuf);
+    std::swap(f.hud_buf, hud_buf);
+    f.debug_buf = debug_buf; // copied, it is not rebuilt every frame
+
+    return presenter->submit();
 }
 
 } /* end of namespace tc */
@@ -5,13 +5,21 @@
 
 #include "buffer.hpp"
 #include "fragment.hpp"
+#include "fragment_buffer.hpp"
 #include "mesh.hpp"
 #include "../world/block.hpp"
 #include "draw_util.hpp"
+#include "cell.hpp"
+#include "frame_sink.hpp"
+#include "presenter.hpp"
+#include "pipeline.hpp"
+#include "vertex_stream.hpp"
+#include "occlusion_buffer.hpp"
 #include "../shaders/vert_shaders.hpp"
 #include "../shaders/frag_shaders.hpp"
 #include "../shaders/post_shaders.hpp"
 #include "../user_settings.hpp"
+#include "../profiler.hpp"
 
 #include <string>
 #include <cstdio>
@@ -22,32 +30,99 @@
 #include <iterator>
 #include <vector>
 #include <optional>
-#include <list>
+#include <memory>
+#include <chrono>
+#include <omp.h>
+#include <cstdint>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace tc {
 
+// edge functions E_k(p) = A[k] * p.x + B[k] * p.y + C[k] of a triangle in fixed point (see Render::setup_tri)
+struct raster_setup {
+    glm::ivec2 bb_min; // in pixels, max exclusive
+    glm::ivec2 bb_max;
+    int order[3]; // vertex order with positive area
+    int64_t A[3], B[3], C[3];
+    int64_t bias[3]; // fill rule
+    float inv_area;
+    bool fits_int32;
+};
+
+// the pipeline of the game, specialized for each combination of render features
+template <unsigned features>
+using default_pipeline = pipeline<vert_shaders::VERT_camera, frag_shaders::FRAG_shaded<features>, post_shaders::POST_vignette, features>;
+
+// a range of triangles of the world mesh and where their vertices are in the vertex stream
+struct vertex_work {
+    int begin;
+    int end; // exclusive
+    int stream_begin; // a multiple of vertex_stream::batch_size
+};
+
 class Render {
 public:
     Render(int p_X_size, int p_Y_size);
     Render() {}
 
-    void render(mesh m);
+    bool render(std::shared_ptr<const mesh> world_mesh);
     void set_debug_info(std::string debug_info);
+    void set_sink(std::shared_ptr<Frame_Sink> p_sink);
+    void stop_output();
     void set_params(int p_X_size, int p_Y_size, float p_global_time, float p_time_of_day, glm::mat4 p_V, glm::mat4 p_VP, block_type::Block_Type p_active_block_type, bool p_flying, bool p_crouching, bool p_sprinting);
     void get_params(int *n_tris_ptr, int *n_active_tris_ptr);
+    void get_culling_stats(int *n_sections_ptr, int *n_visible_sections_ptr, int *n_occluded_sections_ptr);
+    void get_render_scale(float *scale_ptr, int *X_res_ptr, int *Y_res_ptr);
+    void get_output_stats(size_t *frame_bytes_ptr, float *encode_time_ptr, int *n_dropped_ptr);
 
 private:
+    void select_pipeline();
+    void update_resolution();
+    void update_render_scale(float frame_time);
     void time_of_day_update();
     void clear_buffers();
-    void execute_vertex_shader(mesh *m, void (*vert_shader)(vertex*, glm::mat4, glm::mat4, float));
-    void rasterize(mesh *m);
-    void execute_fragment_and_post_shaders(glm::vec3 (*frag_shader)(fragment, glm::vec3, float, float),
-                                           glm::vec3 (*post_shader)(const buffer<glm::vec3>*, glm::ivec2, glm::ivec2, float));
+    // pipeline stages, specialized for a pipeline P (see pipeline.hpp)
+    template <typename P> void run_pipeline(const std::shared_ptr<const mesh> &world_mesh);
+    template <typename P> void execute_vertex_shader(const std::shared_ptr<const mesh> &world_mesh);
+    template <typename P> void project_tri(tri *triangle);
+    template <typename P> bool cull_tri(tri *triangle);
+    template <typename P> void run_vertex_work(const std::vector<tri> &tri_list);
+    int update_stream_sections(const mesh &world_mesh);
+    void gather_positions(const std::vector<tri> &tri_list);
+    void collect_visible_sections(bool cull);
+    void add_vertex_work(int section_index);
+    template <typename P> void build_occlusion_buffer();
+    bool is_section_occluded(int section_index);
+    template <typename P> void emit_stream_tri(int v, const tri &source, std::vector<tri> *out);
+    void bin_triangles(mesh *m);
+    template <typename P> void rasterize_and_shade(mesh *m);
+    bool setup_tri(const tri &triangle, raster_setup *setup_ptr);
+    template <typename P> material::Material_Class get_material(const tri &triangle);
+    template <typename P> bool keeps_backfaces(const tri &triangle);
+    template <typename P, material::Material_Class M> void rasterize_tri(const tri &triangle, uint32_t tri_index, const raster_setup &setup, glm::ivec2 rect_min, glm::ivec2 rect_max);
+    template <typename P> void resolve_tile(mesh *m, glm::ivec2 tile_min, glm::ivec2 tile_max);
+    template <typename P> void execute_post_shader();
+    void upscale_fbuf(buffer<glm::vec3> *out_ptr);
     void construct_hud();
-    void draw_fbuf();
+    bool submit_frame();
 
-    int X_size;
+    // the specialization of run_pipeline for the current settings
+    void (Render::*pipeline_fn)(const std::shared_ptr<const mesh> &world_mesh) = nullptr;
+
+    int X_size; // in cells
     int Y_size;
+    int X_out_res; // in pixels
+    int Y_out_res;
+    int X_res; // in pixels, scaled
+    int Y_res;
+
+    // dynamic resolution scaling (levels below U.min_render_scale are skipped)
+    static constexpr float render_scale_levels[] = {1.0f, 0.75f, 0.5f, 0.33f};
+    int scale_level = 0;
+    float smoothed_frame_time = 0.0f; // in milliseconds
+    int frames_since_scale_change = 0;
     float global_time = 0.0f;
     float time_of_day = 0.0f;
     glm::vec3 sun_direction {1.0f};
@@ -60,11 +135,34 @@ private:
 
     int n_tris = 0;
     int n_active_tris = 0;
+    int n_sections = 0;
+    int n_visible_sections = 0; // in the view frustum
+    int n_occluded_sections = 0;
+
+    buffer<glm::vec3> fbuf; // at the render resolution
+    Fragment_Buffer frag_buf;
+
+    // per-frame scratch data, kept between frames to reuse the memory
+    std::shared_ptr<const mesh> stream_mesh; // the world mesh whose positions are in verts
+    vertex_stream verts;
+    std::vector<vertex_work> stream_sections; // per section of stream_mesh
+    std::vector<mesh_section> section_bounds;
+    std::vector<std::pair<float, int>> section_order; // (squared distance, section)
+    std::vector<int> visible_sections; // in the view frustum, nearest first
+    std::vector<vertex_work> vertex_work_items; // pieces of the sections to process
+    Occlusion_Buffer occlusion_buf;
+    std::vector<std::vector<tri>> thread_tris; // [thread] visible triangles, concatenated into frame_mesh
+    mesh frame_mesh; // the visible triangles of this frame, in screen space
 
-    buffer<glm::vec3> fbuf;
-    buffer<std::list<fragment>> frag_buf;
-    buffer<std::string> hud_buf;
+    // tile binning: triangle indices per tile (tile_x * n_tiles_y + tile_y)
+    int n_tiles_x = 0;
+    int n_tiles_y = 0;
+    std::vector<std::vector<int>> tile_bins;
+    std::vector<std::vector<std::vector<int>>> thread_bins; // [thread][tile], merged into tile_bins
+    std::vector<raster_setup> tri_setups; // per triangle of the mesh
+    buffer<cell> hud_buf;
     buffer<char> debug_buf;
+    std::unique_ptr<Presenter> presenter;
 };
 
 } /* end of namespace tc */
@@ -0,0 +1,67 @@
+#include "screen.hpp"
+
+using namespace std;
+
+namespace tc {
+
+// public:
+
+bool Screen::present(const buffer<cell> &frame, int p_X_size, int p_Y_size, Frame_Sink *sink) {
+    chrono::high_resolution_clock timer;
+    auto timer_start = timer.now();
+
+    if (p_X_size != X_size || p_Y_size != Y_size) {
+        X_size = p_X_size;
+        Y_size = p_Y_size;
+        invalidate();
+    }
+
+    encoder.begin_frame(X_size);
+
+    for (int y = 0; y < Y_size; ++y) {
+        for (int x = 0; x < X_size; ++x) {
+            const cell &c = frame.buf[x][y];
+            if (!cell_changed(front_buf.buf[x][y], c)) continue;
+
+            encoder.move_cursor(x, y);
+            encoder.put_cell(c);
+            front_buf.buf[x][y] = c;
+        }
+    }
+
+    encoder.end_frame();
+
+    auto timer_end = timer.now();
+    encode_time = chrono::duration_cast<chrono::microseconds>(timer_end - timer_start).count() / 1000.0f;
+    frame_bytes = encoder.size();
+
+    // the whole frame in a single write
+    return sink->write_bytes(encoder.get_bytes().data(), encoder.size());
+}
+
+void Screen::invalidate() {
+    // glyph '\0' is never printed, so every cell counts as changed
+    cell invalid {};
+    invalid.glyph = '\0';
+    front_buf.clear(X_size, Y_size, invalid);
+}
+
+void Screen::get_stats(size_t *bytes_ptr, float *encode_time_ptr) {
+    *bytes_ptr = frame_bytes;
+    *encode_time_ptr = encode_time;
+}
+
+// private:
+
+bool Screen::cell_changed(const cell &shown, const cell &c) {
+    if (shown.glyph != c.glyph || shown.attr != c.attr) return true;
+
+    /* Colors within the tolerance count as unchanged, the front buffer
+     * then keeps the shown color so that small changes can't add up. */
+    if (shown.bg != c.bg && draw_util::color_distance(shown.bg, c.bg) > U.color_tolerance) return true;
+    if (shown.fg != c.fg && draw_util::color_distance(shown.fg, c.fg) > U.color_tolerance) return true;
+
+    return false;
+}
+
+} /* end of namespace tc */
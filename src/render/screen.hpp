@@ -0,0 +1,41 @@
+#ifndef SCREEN_HPP
+#define SCREEN_HPP
+
+#include "buffer.hpp"
+#include "cell.hpp"
+#include "draw_util.hpp"
+#include "encoder.hpp"
+#include "frame_sink.hpp"
+#include "../user_settings.hpp"
+
+#include <chrono>
+#include <cstddef>
+
+namespace tc {
+
+/* Keeps a copy of what is currently shown in the terminal (front buffer)
+ * and only prints the cells of a new frame that differ from it. */
+class Screen {
+public:
+    Screen() {}
+
+    bool present(const buffer<cell> &frame, int p_X_size, int p_Y_size, Frame_Sink *sink);
+    void invalidate();
+    void get_stats(size_t *bytes_ptr, float *encode_time_ptr);
+
+private:
+    bool cell_changed(const cell &shown, const cell &c);
+
+    int X_size = 0;
+    int Y_size = 0;
+    buffer<cell> front_buf;
+    Encoder encoder;
+
+    // stats of the last frame (for debug info)
+    size_t frame_bytes = 0;
+    float encode_time = 0.0f; // in milliseconds
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: SCREEN_HPP */
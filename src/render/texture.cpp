@@ -1,90 +1,352 @@
 #include "texture.hpp"
 
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
 namespace tc {
 
-// Texture:
+namespace {
+
+const int min_log2_atlas_width = 8;
+const size_t texel_alignment = 64;
+
+// alpha between these is partially transparent, cutouts have few such texels
+const uint32_t near_transparent_alpha = 8;
+const uint32_t near_opaque_alpha = 247;
+const float max_partial_fraction = 0.25f;
+
+int log2_ceil(int n) {
+    int l = 0;
+    while ((1 << l) < n) ++l;
+    return l;
+}
+
+const char pack_magic[4] = {'T', 'C', 'T', 'P'};
+const uint32_t pack_version = 1;
+
+uint32_t read_u32(const unsigned char **p, const unsigned char *end, bool *ok) {
+    if (end - *p < 4) {
+        *ok = false;
+        return 0;
+    }
+    const unsigned char *b = *p;
+    *p += 4;
+    return static_cast<uint32_t>(b[0]) | static_cast<uint32_t>(b[1]) << 8 | static_cast<uint32_t>(b[2]) << 16 | static_cast<uint32_t>(b[3]) << 24;
+}
+
+// tiles are powers of two up to the size of level 0 of the longest mip chain
+bool is_valid_tile_size(uint32_t size) {
+    return size >= 1 && size <= (1u << (atlas_texture::max_mips - 1)) && (size & (size - 1)) == 0;
+}
+
+void write_u32(std::string *out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out->push_back(static_cast<char>((v >> (i * 8)) & 0xff));
+}
+
+uint32_t pack_rgba(const unsigned char *c) {
+    return static_cast<uint32_t>(c[0])
+         | static_cast<uint32_t>(c[1]) << 8
+         | static_cast<uint32_t>(c[2]) << 16
+         | static_cast<uint32_t>(c[3]) << 24;
+}
+
+} /* end of anonymous namespace */
+
+// Texture_Atlas:
+
+// public:
+
+bool Texture_Atlas::set_pack(const unsigned char *data, size_t size) {
+    pack_index.clear();
+
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    bool ok = size >= sizeof(pack_magic) && memcmp(data, pack_magic, sizeof(pack_magic)) == 0;
+    if (!ok) return false;
+    p += sizeof(pack_magic);
+    ok = read_u32(&p, end, &ok) == pack_version && ok;
+
+    const uint32_t n_textures = read_u32(&p, end, &ok);
+    for (uint32_t i = 0; i < n_textures && ok; ++i) {
+        const uint32_t path_length = read_u32(&p, end, &ok);
+        if (!ok || static_cast<size_t>(end - p) < path_length) break;
+        const std::string path {reinterpret_cast<const char*>(p), path_length};
+        p += path_length;
+
+        // validated here (so that load_packed can't fail) and skipped over to the next texture
+        const unsigned char *begin = p;
+        const uint32_t material_class = read_u32(&p, end, &ok);
+        const uint32_t n_mips = read_u32(&p, end, &ok);
+        ok = ok && material_class <= material::TRANSLUCENT && n_mips >= 1 && n_mips <= atlas_texture::max_mips;
+        for (uint32_t level = 0; level < n_mips && ok; ++level) {
+            const uint32_t width = read_u32(&p, end, &ok);
+            const uint32_t height = read_u32(&p, end, &ok);
+            ok = ok && is_valid_tile_size(width) && is_valid_tile_size(height);
+            const uint64_t n_texels = static_cast<uint64_t>(width) * height;
+            ok = ok && static_cast<uint64_t>(end - p) >= n_texels * 4;
+            if (ok) p += n_texels * 4;
+        }
+        if (ok) pack_index[path] = {begin, p};
+    }
+
+    if (!ok) pack_index.clear();
+    return ok;
+}
+
+void Texture_Atlas::set_image_dir(const std::string &dir) {
+    image_dir = dir;
+}
+
+atlas_texture Texture_Atlas::add(const std::string &relative_path) {
+    auto it = loaded.find(relative_path);
+    if (it != loaded.end()) return it->second;
+
+    atlas_texture t;
+    auto packed = pack_index.find(relative_path);
+    if (packed == pack_index.end() || !load_packed(packed->second.first, packed->second.second - packed->second.first, &t)) {
+        t = atlas_texture {};
+        load_image(relative_path, &t);
+    }
+
+    t.log2_size = 0.5f * (log2_ceil(t.mips[0].width) + log2_ceil(t.mips[0].height));
+    t.average = sample(t.mips[t.n_mips - 1], glm::vec2(0.0f));
+
+    loaded.emplace(relative_path, t);
+    return t;
+}
 
-Texture::Texture(const std::string relative_path) {
-    #ifdef BUILD_PATH
-        std::string full_path = BUILD_PATH;
-    #else
-        std::string full_path = ".";
-    #endif
-    full_path.append("/").append(relative_path);
+std::string Texture_Atlas::write_pack(const std::vector<std::string> &relative_paths) const {
+    std::string out {pack_magic, sizeof(pack_magic)};
+    write_u32(&out, pack_version);
+    write_u32(&out, relative_paths.size());
 
+    for (const std::string &path : relative_paths) {
+        const atlas_texture &t = loaded.at(path);
+        write_u32(&out, path.size());
+        out.append(path);
+        write_u32(&out, t.material);
+        write_u32(&out, t.n_mips);
+        for (int level = 0; level < t.n_mips; ++level) {
+            const atlas_rect &rect = t.mips[level];
+            write_u32(&out, rect.width);
+            write_u32(&out, rect.height);
+            for (int y = 0; y < rect.height; ++y) {
+                for (int x = 0; x < rect.width; ++x) write_u32(&out, texel(rect, x, y));
+            }
+        }
+    }
+
+    return out;
+}
+
+void Texture_Atlas::get_size(int *p_width, int *p_height) const {
+    *p_width = 1 << log2_width;
+    *p_height = height;
+}
+
+// private:
+
+// decoded, converted and filtered at runtime
+void Texture_Atlas::load_image(const std::string &relative_path, atlas_texture *t_ptr) {
+    const std::string full_path = image_dir + "/" + relative_path;
+
+    const int channels = 4;
+    glm::ivec2 size {0};
+    int real_channels = 0;
     unsigned char *data = stbi_load(full_path.c_str(), &size.x, &size.y, &real_channels, channels);
 
+    atlas_texture &t = *t_ptr;
     if (!data) {
-        pixels.emplace_back();
-        pixels[0].emplace_back(1.0f, 0.0f, 1.0f); // magenta for missing textures
-        alpha.emplace_back();
-        alpha[0].emplace_back(1.0f);
-        size = {1, 1};
-        real_channels = 0;
-        return;
+        t.mips[0] = place(1, 1);
+        const unsigned char magenta[] {255, 0, 255, 255}; // for missing textures
+        texel(t.mips[0], 0, 0) = pack_rgba(magenta);
+    } else {
+        // nearest neighbour resize to the power of two tile
+        const int max_log2_size = atlas_texture::max_mips - 1;
+        t.mips[0] = place(1 << min(log2_ceil(size.x), max_log2_size), 1 << min(log2_ceil(size.y), max_log2_size));
+        for (int y = 0; y < t.mips[0].height; ++y) {
+            const int src_y = y * size.y / t.mips[0].height;
+            for (int x = 0; x < t.mips[0].width; ++x) {
+                const int src_x = x * size.x / t.mips[0].width;
+                texel(t.mips[0], x, y) = pack_rgba(&data[(src_y * size.x + src_x) * channels]);
+            }
+        }
+        stbi_image_free(data);
     }
 
-    float inverse_char_max = 1.0f / 255.0f;
-
-    for (int x = 0; x < size.x; ++x) {
-        pixels.emplace_back();
-        alpha.emplace_back();
-        for (int y = 0; y < size.y; ++y) {
-            pixels[x].push_back(glm::vec3 {
-                static_cast<float>(data[y*size.x*channels + x*channels + 0]),
-                static_cast<float>(data[y*size.x*channels + x*channels + 1]),
-                static_cast<float>(data[y*size.x*channels + x*channels + 2])
-            } * inverse_char_max);
-            alpha[x].push_back(static_cast<float>(data[y*size.x*channels + x*channels + 3]) * inverse_char_max);
+    /* classified on level 0, the alpha test samples it: a few partially
+     * transparent texels (like soft edges) are still alpha tested */
+    int n_visible = 0, n_partial = 0;
+    bool all_opaque = true;
+    for (int y = 0; y < t.mips[0].height; ++y) {
+        for (int x = 0; x < t.mips[0].width; ++x) {
+            const uint32_t a = texel(t.mips[0], x, y) >> 24;
+            all_opaque = all_opaque && a == 255;
+            n_visible += a > 0;
+            n_partial += a > near_transparent_alpha && a < near_opaque_alpha;
+        }
+    }
+    if (!all_opaque) {
+        t.material = n_partial > n_visible * max_partial_fraction ? material::TRANSLUCENT : material::CUTOUT;
+    }
+
+    while (t.mips[t.n_mips - 1].width > 1 || t.mips[t.n_mips - 1].height > 1) {
+        t.mips[t.n_mips] = build_mip(t.mips[t.n_mips - 1]);
+        ++t.n_mips;
+    }
+}
+
+// copies the tiles of a pack entry, returns false if it doesn't fit into an atlas_texture
+bool Texture_Atlas::load_packed(const unsigned char *data, size_t size, atlas_texture *t) {
+    const unsigned char *p = data;
+    const unsigned char *end = data + size;
+    bool ok = true;
+
+    const uint32_t material_class = read_u32(&p, end, &ok);
+    const uint32_t n_mips = read_u32(&p, end, &ok);
+    if (!ok || material_class > material::TRANSLUCENT || n_mips < 1 || n_mips > atlas_texture::max_mips) return false;
+    t->material = static_cast<material::Material_Class>(material_class);
+    t->n_mips = n_mips;
+
+    for (uint32_t level = 0; level < n_mips; ++level) {
+        const uint32_t width = read_u32(&p, end, &ok);
+        const uint32_t height = read_u32(&p, end, &ok);
+        if (!ok || !is_valid_tile_size(width) || !is_valid_tile_size(height)) return false;
+
+        t->mips[level] = place(width, height);
+        for (uint32_t y = 0; y < height; ++y) {
+            for (uint32_t x = 0; x < width; ++x, p += 4) texel(t->mips[level], x, y) = pack_rgba(p);
+        }
+    }
+    return true;
+}
+
+atlas_rect Texture_Atlas::place(int tile_width, int tile_height) {
+    int new_log2_width = max(max(log2_width, min_log2_atlas_width), log2_ceil(tile_width));
+
+    if (shelf_x + tile_width > (1 << new_log2_width)) {
+        shelf_y += shelf_height;
+        shelf_x = 0;
+        shelf_height = 0;
+    }
+
+    atlas_rect rect {shelf_x, shelf_y, tile_width, tile_height};
+    shelf_x += tile_width;
+    shelf_height = max(shelf_height, tile_height);
+
+    resize(new_log2_width, max(height, shelf_y + shelf_height));
+    return rect;
+}
+
+/* Box filter of the level above, the colors are weighted by alpha so
+ * that transparent texels of cutouts don't darken the edges. */
+atlas_rect Texture_Atlas::build_mip(const atlas_rect &src) {
+    const atlas_rect src_rect = src; // place can move the texels, not the rects
+    atlas_rect dst = place(max(src_rect.width / 2, 1), max(src_rect.height / 2, 1));
+
+    for (int y = 0; y < dst.height; ++y) {
+        for (int x = 0; x < dst.width; ++x) {
+            const int xs[2] = {x * 2, min(x * 2 + 1, src_rect.width - 1)};
+            const int ys[2] = {y * 2, min(y * 2 + 1, src_rect.height - 1)};
+
+            uint32_t color_sum[3] = {0, 0, 0};
+            uint32_t alpha_sum = 0;
+            for (int sy : ys) {
+                for (int sx : xs) {
+                    const uint32_t t = texel(src_rect, sx, sy);
+                    const uint32_t a = t >> 24;
+                    for (int c = 0; c < 3; ++c) color_sum[c] += ((t >> (c * 8)) & 0xff) * a;
+                    alpha_sum += a;
+                }
+            }
+
+            unsigned char rgba[4] = {0, 0, 0, static_cast<unsigned char>((alpha_sum + 2) / 4)};
+            if (alpha_sum > 0) {
+                for (int c = 0; c < 3; ++c) rgba[c] = static_cast<unsigned char>((color_sum[c] + alpha_sum / 2) / alpha_sum);
+            }
+            texel(dst, x, y) = pack_rgba(rgba);
         }
     }
 
-    stbi_image_free(data);
+    return dst;
 }
 
-glm::vec4 Texture::sample(const glm::vec2 tex_coord) const {
-    glm::ivec2 corrected_tex_coord {glm::clamp(int(tex_coord.x * size.x), 0, size.x-1),
-                                    glm::clamp(int(tex_coord.y * size.y), 0, size.y-1)};
-    return glm::vec4 {pixels[corrected_tex_coord.x][corrected_tex_coord.y], alpha[corrected_tex_coord.x][corrected_tex_coord.y]};
+uint32_t &Texture_Atlas::texel(const atlas_rect &rect, int x, int y) {
+    return texels[(static_cast<size_t>(rect.y + y) << log2_width) + rect.x + x];
+}
+
+uint32_t Texture_Atlas::texel(const atlas_rect &rect, int x, int y) const {
+    return texels[(static_cast<size_t>(rect.y + y) << log2_width) + rect.x + x];
+}
+
+/* The texels keep their coordinates. Rows are allocated in advance
+ * (doubling), so that adding textures one by one doesn't copy all of
+ * them every time. */
+void Texture_Atlas::resize(int p_log2_width, int p_height) {
+    if (p_log2_width == log2_width && p_height <= capacity_rows && texels) {
+        height = p_height;
+        return;
+    }
+
+    const size_t new_width = static_cast<size_t>(1) << p_log2_width;
+    const int new_capacity_rows = p_log2_width == log2_width ? max(p_height, capacity_rows * 2) : p_height;
+    size_t bytes = new_width * new_capacity_rows * sizeof(uint32_t);
+    bytes = (bytes + texel_alignment - 1) / texel_alignment * texel_alignment;
+
+    unique_ptr<uint32_t[], free_deleter> new_texels {static_cast<uint32_t*>(aligned_alloc(texel_alignment, bytes))};
+    fill(new_texels.get(), new_texels.get() + new_width * new_capacity_rows, 0u);
+    if (texels) {
+        const size_t old_width = static_cast<size_t>(1) << log2_width;
+        for (int y = 0; y < height; ++y) {
+            memcpy(&new_texels[y * new_width], &texels[y * old_width], old_width * sizeof(uint32_t));
+        }
+    }
+
+    texels = move(new_texels);
+    log2_width = p_log2_width;
+    height = p_height;
+    capacity_rows = new_capacity_rows;
 }
 
 // Texture_Set:
 
-Texture_Set::Texture_Set(const std::string path) {
-    std::shared_ptr<Texture> t = std::make_shared<Texture>(Texture {path});
-    textures[tex::LEFT] = t;
-    textures[tex::RIGHT] = t;
-    textures[tex::TOP] = t;
-    textures[tex::BOTTOM] = t;
-    textures[tex::FRONT] = t;
-    textures[tex::BACK] = t;
-}
-
-Texture_Set::Texture_Set(const std::string path_side, const std::string path_top_bottom) {
-    std::shared_ptr<Texture> ta = std::make_shared<Texture>(Texture {path_side});
-    std::shared_ptr<Texture> tb = std::make_shared<Texture>(Texture {path_top_bottom});
-    textures[tex::LEFT] = ta;
-    textures[tex::RIGHT] = ta;
-    textures[tex::TOP] = tb;
-    textures[tex::BOTTOM] = tb;
-    textures[tex::FRONT] = ta;
-    textures[tex::BACK] = ta;
-}
-
-Texture_Set::Texture_Set(const std::string path_side, const std::string path_top, const std::string path_bottom) {
-    std::shared_ptr<Texture> ta = std::make_shared<Texture>(Texture {path_side});
-    std::shared_ptr<Texture> tb = std::make_shared<Texture>(Texture {path_top});
-    std::shared_ptr<Texture> tc = std::make_shared<Texture>(Texture {path_bottom});
-    textures[tex::LEFT] = ta;
-    textures[tex::RIGHT] = ta;
-    textures[tex::TOP] = tb;
-    textures[tex::BOTTOM] = tc;
-    textures[tex::FRONT] = ta;
-    textures[tex::BACK] = ta;
-}
-
-glm::vec4 Texture_Set::sample(const glm::vec2 tex_coord, const unsigned int side) const {
-    return textures[side]->sample(tex_coord);
+Texture_Set::Texture_Set(Texture_Atlas *atlas, const std::string &path_side, const std::string &path_top, const std::string &path_bottom) {
+    atlas_texture side = atlas->add(path_side);
+    textures[tex::LEFT] = side;
+    textures[tex::RIGHT] = side;
+    textures[tex::TOP] = atlas->add(path_top);
+    textures[tex::BOTTOM] = atlas->add(path_bottom);
+    textures[tex::FRONT] = side;
+    textures[tex::BACK] = side;
+
+    for (const atlas_texture &t : textures) {
+        material = max(material, t.material);
+    }
+}
+
+// Texture_Registry:
+
+Texture_Registry texture_registry;
+
+bool Texture_Registry::set_pack(const unsigned char *data, size_t size) {
+    return atlas.set_pack(data, size);
+}
+
+void Texture_Registry::set_image_dir(const std::string &dir) {
+    atlas.set_image_dir(dir);
+}
+
+texture_handle Texture_Registry::add_set(const std::string &path_side, const std::string &path_top, const std::string &path_bottom) {
+    const std::string key = path_side + '\n' + path_top + '\n' + path_bottom;
+    auto it = set_handles.find(key);
+    if (it != set_handles.end()) return it->second;
+
+    sets.emplace_back(&atlas, path_side, path_top, path_bottom);
+    const texture_handle handle = static_cast<texture_handle>(sets.size()) - 1;
+    set_handles.emplace(key, handle);
+    return handle;
 }
 
 } /* end of namespace tc */
@@ -5,8 +5,11 @@
 #include "../../lib/stb/stb_image.h"
 
 #include <string>
-#include <vector>
 #include <memory>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
 
 namespace tc {
 
@@ -21,32 +24,174 @@ namespace tex {
     };
 } /* end of namespace tex */
 
-class Texture {
+/* How a texture covers what is behind it, from its alpha channel:
+ * opaque needs no alpha at all, cutout texels are either fully opaque or
+ * fully transparent (an alpha test) and only translucent textures need
+ * blending. */
+namespace material {
+    enum Material_Class {
+        OPAQUE,
+        CUTOUT,
+        TRANSLUCENT
+    };
+} /* end of namespace material */
+
+// a texture in the atlas, both sizes are powers of two
+struct atlas_rect {
+    int x = 0, y = 0; // top left texel
+    int width = 1, height = 1;
+};
+
+// a texture with its mip chain in the atlas, level 0 is the full size
+struct atlas_texture {
+    static const int max_mips = 12; // up to 2048x2048
+
+    atlas_rect mips[max_mips];
+    int n_mips = 1;
+    float log2_size = 0.0f; // of level 0, the mean of width and height
+    material::Material_Class material = material::OPAQUE;
+    glm::vec4 average {0.0f}; // the last level, the texture is this far away
+};
+
+/* All textures in one RGBA8 image (row major, 64 byte aligned rows of
+ * a power of two width). Every texture is resized to a power of two
+ * tile and packed into shelves (followed by its mips, each halving the
+ * size down to 1x1), each path is loaded only once.
+ *
+ * Textures come from a texture pack if it has the path: the tiles of
+ * all mips and the material class, converted at build time (see
+ * src/texpack.cpp), so they are only copied. Other paths are decoded
+ * from png files under the image directory.
+ * Pack format (little endian): "TCTP", u32 version, u32 n_textures,
+ * per texture: u32 path length, path, u32 material class, u32 n_mips,
+ * per mip: u32 width, u32 height, width * height RGBA8 texels. */
+class Texture_Atlas {
 public:
-    Texture(const std::string relative_path);
+    Texture_Atlas() {}
 
-    glm::vec4 sample(const glm::vec2 tex_coord) const;
+    // the pack is not copied, returns false if it is invalid
+    bool set_pack(const unsigned char *data, size_t size);
+    void set_image_dir(const std::string &dir);
+    atlas_texture add(const std::string &relative_path);
+    // a pack of the textures at these (added) paths
+    std::string write_pack(const std::vector<std::string> &relative_paths) const;
+
+    // nearest texel of one level
+    glm::vec4 sample(const atlas_rect &rect, const glm::vec2 tex_coord) const {
+        const int x = glm::clamp(int(tex_coord.x * rect.width), 0, rect.width - 1);
+        const int y = glm::clamp(int(tex_coord.y * rect.height), 0, rect.height - 1);
+        const uint32_t texel = texels[(static_cast<size_t>(rect.y + y) << log2_width) + rect.x + x];
+
+        const float inverse_char_max = 1.0f / 255.0f;
+        return glm::vec4 {
+            static_cast<float>(texel & 0xff),
+            static_cast<float>((texel >> 8) & 0xff),
+            static_cast<float>((texel >> 16) & 0xff),
+            static_cast<float>(texel >> 24)
+        } * inverse_char_max;
+    }
+
+    void get_size(int *p_width, int *p_height) const;
 
 private:
-    glm::ivec2 size {0};
-    int real_channels = 0;
-    const int channels = 4;
-    std::vector<std::vector<glm::vec3>> pixels;
-    std::vector<std::vector<float>> alpha;
+    void load_image(const std::string &relative_path, atlas_texture *t);
+    bool load_packed(const unsigned char *data, size_t size, atlas_texture *t);
+    atlas_rect place(int tile_width, int tile_height);
+    atlas_rect build_mip(const atlas_rect &src);
+    uint32_t &texel(const atlas_rect &rect, int x, int y);
+    uint32_t texel(const atlas_rect &rect, int x, int y) const;
+    void resize(int p_log2_width, int p_height);
+
+    struct free_deleter {
+        void operator()(uint32_t *p) const { std::free(p); }
+    };
+
+    int log2_width = 0;
+    int height = 0;
+    int capacity_rows = 0;
+    std::unique_ptr<uint32_t[], free_deleter> texels;
+
+    // shelf packing: tiles are placed left to right in rows as high as their highest tile
+    int shelf_x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+
+    std::unordered_map<std::string, atlas_texture> loaded;
+
+    // where each texture of the pack begins (after its path) and ends
+    std::unordered_map<std::string, std::pair<const unsigned char*, const unsigned char*>> pack_index;
+    #ifdef BUILD_PATH
+        std::string image_dir = BUILD_PATH;
+    #else
+        std::string image_dir = ".";
+    #endif
 };
 
 class Texture_Set {
 public:
-    Texture_Set(const std::string path);
-    Texture_Set(const std::string path_side, const std::string path_top_bottom);
-    Texture_Set(const std::string path_side, const std::string path_top, const std::string path_bottom);
+    Texture_Set(Texture_Atlas *atlas, const std::string &path_side, const std::string &path_top, const std::string &path_bottom);
+
+    // the most demanding class of its sides
+    material::Material_Class get_material() const {
+        return material;
+    }
 
+    // full resolution
     glm::vec4 sample(const glm::vec2 tex_coord, const unsigned int side) const;
 
+    /* Nearest texel of the nearest mip level, lod is the log2 of the
+     * texture coordinate change per pixel (see tri::tex_lod).
+     * The smallest level is the average color, it needs no lookup. */
+    glm::vec4 sample(const glm::vec2 tex_coord, const unsigned int side, const float lod) const;
+
+private:
+    atlas_texture textures[6];
+    material::Material_Class material = material::OPAQUE;
+};
+
+typedef int texture_handle;
+
+/* All textures of the game in one atlas. It is filled explicitly once
+ * the options are parsed (see block_type::load_block_textures), nothing
+ * is decoded during static initialization. Images and sets are loaded
+ * once per path, handles stay valid. */
+class Texture_Registry {
+public:
+    Texture_Registry() {}
+
+    // where textures are loaded from, before the first set is added
+    bool set_pack(const unsigned char *data, size_t size);
+    void set_image_dir(const std::string &dir);
+
+    texture_handle add_set(const std::string &path_side, const std::string &path_top, const std::string &path_bottom);
+
+    const Texture_Set &get(texture_handle handle) const {
+        return sets[handle];
+    }
+
+    const Texture_Atlas &get_atlas() const {
+        return atlas;
+    }
+
 private:
-    std::shared_ptr<Texture> textures[6];
+    Texture_Atlas atlas;
+    std::vector<Texture_Set> sets;
+    std::unordered_map<std::string, texture_handle> set_handles;
 };
 
+extern Texture_Registry texture_registry;
+
+inline glm::vec4 Texture_Set::sample(const glm::vec2 tex_coord, const unsigned int side) const {
+    return texture_registry.get_atlas().sample(textures[side].mips[0], tex_coord);
+}
+
+inline glm::vec4 Texture_Set::sample(const glm::vec2 tex_coord, const unsigned int side, const float lod) const {
+    const atlas_texture &t = textures[side];
+    const int level = static_cast<int>(glm::max(lod + t.log2_size + 0.5f, 0.0f));
+    if (level >= t.n_mips - 1) return t.average;
+    return texture_registry.get_atlas().sample(t.mips[level], tex_coord);
+}
+
 } /* end of namespace tc */
 
 #endif /* end of include guard: TEXTURE_HPP */
@@ -0,0 +1,14 @@
+#ifndef TEXTURE_PACK_HPP
+#define TEXTURE_PACK_HPP
+
+#include <cstddef>
+
+namespace tc {
+
+// res/tex converted at build time (generated by termcraft_texpack, see Texture_Atlas)
+extern const unsigned char texture_pack[];
+extern const size_t texture_pack_size;
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: TEXTURE_PACK_HPP */
@@ -21,6 +21,7 @@ struct tri {
     glm::vec3 view_normal {0.0f};
     block *block_ptr;
     unsigned int block_side_index = 0;
+    float tex_lod = 0.0f; // log2 of the texture coordinate change per pixel, set after the screen transform
 
     glm::vec3 calc_normal();
 };
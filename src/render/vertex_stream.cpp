@@ -0,0 +1,180 @@
+#include "vertex_stream.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <initializer_list>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define TC_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace tc {
+
+namespace {
+
+typedef void (*transform_fn)(vertex_stream*, const stream_transform&, size_t, size_t);
+
+#ifndef TC_X86_DISPATCH
+
+void transform_scalar(vertex_stream *s, const stream_transform &t, size_t begin, size_t end) {
+    const glm::mat4 &M = t.VP;
+    const glm::vec2 half_size = t.screen_size * 0.5f;
+
+    for (size_t i = begin; i < end; ++i) {
+        const float x = s->x[i], y = s->y[i], z = s->z[i];
+
+        const float cx = M[0][0] * x + M[1][0] * y + M[2][0] * z + M[3][0];
+        const float cy = M[0][1] * x + M[1][1] * y + M[2][1] * z + M[3][1];
+        const float cz = M[0][2] * x + M[1][2] * y + M[2][2] * z + M[3][2];
+        const float cw = M[0][3] * x + M[1][3] * y + M[2][3] * z + M[3][3];
+
+        const float inv_w = 1.0f / cw;
+        s->near_dist[i] = cz + cw;
+        s->inv_w[i] = inv_w;
+        s->ndc_x[i] = cx * inv_w;
+        s->ndc_y[i] = cy * inv_w;
+        s->ndc_z[i] = cz * inv_w;
+        s->screen_x[i] = s->ndc_x[i] * half_size.x + half_size.x;
+        s->screen_y[i] = s->ndc_y[i] * half_size.y + half_size.y;
+
+        const float dx = x - t.camera_pos.x, dy = y - t.camera_pos.y, dz = z - t.camera_pos.z;
+        s->distance[i] = sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+#else
+
+// the baseline, every x86-64 cpu has SSE2
+void transform_sse2(vertex_stream *s, const stream_transform &t, size_t begin, size_t end) {
+    const glm::mat4 &M = t.VP;
+    __m128 m[4][4];
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) m[c][r] = _mm_set1_ps(M[c][r]);
+    }
+    const __m128 half_x = _mm_set1_ps(t.screen_size.x * 0.5f);
+    const __m128 half_y = _mm_set1_ps(t.screen_size.y * 0.5f);
+    const __m128 cam_x = _mm_set1_ps(t.camera_pos.x);
+    const __m128 cam_y = _mm_set1_ps(t.camera_pos.y);
+    const __m128 cam_z = _mm_set1_ps(t.camera_pos.z);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (size_t i = begin; i < end; i += 4) {
+        const __m128 x = _mm_loadu_ps(&s->x[i]);
+        const __m128 y = _mm_loadu_ps(&s->y[i]);
+        const __m128 z = _mm_loadu_ps(&s->z[i]);
+
+        __m128 clip[4];
+        for (int r = 0; r < 4; ++r) {
+            clip[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][r], x), _mm_mul_ps(m[1][r], y)),
+                                 _mm_add_ps(_mm_mul_ps(m[2][r], z), m[3][r]));
+        }
+
+        const __m128 inv_w = _mm_div_ps(one, clip[3]);
+        const __m128 ndc_x = _mm_mul_ps(clip[0], inv_w);
+        const __m128 ndc_y = _mm_mul_ps(clip[1], inv_w);
+        _mm_storeu_ps(&s->near_dist[i], _mm_add_ps(clip[2], clip[3]));
+        _mm_storeu_ps(&s->inv_w[i], inv_w);
+        _mm_storeu_ps(&s->ndc_x[i], ndc_x);
+        _mm_storeu_ps(&s->ndc_y[i], ndc_y);
+        _mm_storeu_ps(&s->ndc_z[i], _mm_mul_ps(clip[2], inv_w));
+        _mm_storeu_ps(&s->screen_x[i], _mm_add_ps(_mm_mul_ps(ndc_x, half_x), half_x));
+        _mm_storeu_ps(&s->screen_y[i], _mm_add_ps(_mm_mul_ps(ndc_y, half_y), half_y));
+
+        const __m128 dx = _mm_sub_ps(x, cam_x);
+        const __m128 dy = _mm_sub_ps(y, cam_y);
+        const __m128 dz = _mm_sub_ps(z, cam_z);
+        _mm_storeu_ps(&s->distance[i], _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+void transform_avx2(vertex_stream *s, const stream_transform &t, size_t begin, size_t end) {
+    const glm::mat4 &M = t.VP;
+    __m256 m[4][4];
+    for (int c = 0; c < 4; ++c) {
+        for (int r = 0; r < 4; ++r) m[c][r] = _mm256_set1_ps(M[c][r]);
+    }
+    const __m256 half_x = _mm256_set1_ps(t.screen_size.x * 0.5f);
+    const __m256 half_y = _mm256_set1_ps(t.screen_size.y * 0.5f);
+    const __m256 cam_x = _mm256_set1_ps(t.camera_pos.x);
+    const __m256 cam_y = _mm256_set1_ps(t.camera_pos.y);
+    const __m256 cam_z = _mm256_set1_ps(t.camera_pos.z);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    for (size_t i = begin; i < end; i += 8) {
+        const __m256 x = _mm256_loadu_ps(&s->x[i]);
+        const __m256 y = _mm256_loadu_ps(&s->y[i]);
+        const __m256 z = _mm256_loadu_ps(&s->z[i]);
+
+        __m256 clip[4];
+        for (int r = 0; r < 4; ++r) {
+            clip[r] = _mm256_fmadd_ps(m[0][r], x, _mm256_fmadd_ps(m[1][r], y, _mm256_fmadd_ps(m[2][r], z, m[3][r])));
+        }
+
+        const __m256 inv_w = _mm256_div_ps(one, clip[3]);
+        const __m256 ndc_x = _mm256_mul_ps(clip[0], inv_w);
+        const __m256 ndc_y = _mm256_mul_ps(clip[1], inv_w);
+        _mm256_storeu_ps(&s->near_dist[i], _mm256_add_ps(clip[2], clip[3]));
+        _mm256_storeu_ps(&s->inv_w[i], inv_w);
+        _mm256_storeu_ps(&s->ndc_x[i], ndc_x);
+        _mm256_storeu_ps(&s->ndc_y[i], ndc_y);
+        _mm256_storeu_ps(&s->ndc_z[i], _mm256_mul_ps(clip[2], inv_w));
+        _mm256_storeu_ps(&s->screen_x[i], _mm256_fmadd_ps(ndc_x, half_x, half_x));
+        _mm256_storeu_ps(&s->screen_y[i], _mm256_fmadd_ps(ndc_y, half_y, half_y));
+
+        const __m256 dx = _mm256_sub_ps(x, cam_x);
+        const __m256 dy = _mm256_sub_ps(y, cam_y);
+        const __m256 dz = _mm256_sub_ps(z, cam_z);
+        _mm256_storeu_ps(&s->distance[i], _mm256_sqrt_ps(_mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)))));
+    }
+}
+
+#endif /* TC_X86_DISPATCH */
+
+struct transform_impl {
+    transform_fn fn;
+    const char *isa;
+};
+
+// chosen on first use, the cpu doesn't change
+const transform_impl &select_transform() {
+    static const transform_impl impl = [] {
+#ifdef TC_X86_DISPATCH
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return transform_impl {transform_avx2, "AVX2"};
+        return transform_impl {transform_sse2, "SSE2"};
+#else
+        return transform_impl {transform_scalar, "scalar"};
+#endif
+    }();
+    return impl;
+}
+
+} /* end of anonymous namespace */
+
+void vertex_stream::resize(size_t p_size) {
+    n_vertices = p_size;
+    const size_t padded = (p_size + batch_size - 1) / batch_size * batch_size;
+    for (vector<float> *v : {&x, &y, &z, &near_dist, &inv_w, &ndc_x, &ndc_y, &ndc_z, &screen_x, &screen_y, &distance}) {
+        v->resize(padded);
+    }
+}
+
+size_t vertex_stream::size() const {
+    return n_vertices;
+}
+
+void transform_vertices(vertex_stream *stream, const stream_transform &t, size_t begin, size_t end) {
+    // whole batches, the padding is transformed too
+    end = min((end + vertex_stream::batch_size - 1) / vertex_stream::batch_size * vertex_stream::batch_size, stream->x.size());
+    select_transform().fn(stream, t, begin, end);
+}
+
+const char *vertex_transform_isa() {
+    return select_transform().isa;
+}
+
+} /* end of namespace tc */
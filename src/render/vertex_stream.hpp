@@ -0,0 +1,51 @@
+#ifndef VERTEX_STREAM_HPP
+#define VERTEX_STREAM_HPP
+
+#include "../glm.hpp"
+
+#include <vector>
+#include <cstddef>
+
+namespace tc {
+
+/* Vertex positions and post-transform attributes as a structure of
+ * arrays (vertex i of triangle t is entry t * 3 + i), so that the
+ * camera transform can run on many vertices at once.
+ * The arrays are padded to a multiple of batch_size. */
+struct vertex_stream {
+    static const size_t batch_size = 8;
+
+    void resize(size_t p_size);
+    size_t size() const;
+
+    // input: world position
+    std::vector<float> x, y, z;
+
+    // output
+    std::vector<float> near_dist; // z + w in clip space, in front of the near plane if >= 0
+    std::vector<float> inv_w;
+    std::vector<float> ndc_x, ndc_y, ndc_z;
+    std::vector<float> screen_x, screen_y; // in pixels
+    std::vector<float> distance; // to the camera
+
+private:
+    size_t n_vertices = 0;
+};
+
+struct stream_transform {
+    glm::mat4 VP;
+    glm::vec3 camera_pos;
+    glm::vec2 screen_size; // in pixels
+};
+
+/* Transforms the vertices [begin, end) (begin a multiple of batch_size):
+ * clip space, depth division, screen mapping and camera distance in one
+ * pass. Uses AVX2 or SSE2 depending on the cpu (checked once). */
+void transform_vertices(vertex_stream *stream, const stream_transform &t, size_t begin, size_t end);
+
+// the instruction set transform_vertices uses on this cpu (for debug info)
+const char *vertex_transform_isa();
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: VERTEX_STREAM_HPP */
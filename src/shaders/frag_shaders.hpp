@@ -8,6 +8,7 @@
 #include "../render/draw_util.hpp"
 #include "../user_settings.hpp"
 #include "../render/texture.hpp"
+#include "../render/pipeline.hpp"
 #include "../world/block.hpp"
 
 #include <cmath>
@@ -27,6 +28,8 @@ struct frag_shaders {
         // return interp_color(f);
     }
 
+    // specialized for the render features, see render_feature
+    template <unsigned features>
     static glm::vec3 FRAG_shaded(fragment f, glm::vec3 sun_dir, float sky_brightness, float global_time) {
         float light = glm::dot(face_world_normal(f), sun_dir);
         light = light * 0.3f + 0.7f;
@@ -44,11 +47,11 @@ struct frag_shaders {
         float fog = glm::clamp((1.0f / (U.render_distance - fog_begin)) * (interp_distance(f) - fog_begin), 0.0f, 1.0f);
 
         glm::vec3 albedo;
-        if (U.bad_normals)
+        if (render_feature::enabled<features>(render_feature::bad_normals))
             albedo = glm::sign(face_view_normal(f).z) >= 0.0f ? glm::vec3 {1,0,0} : glm::vec3 {0,0,1};
         else {
-            if (U.disable_textures) albedo = face_color(f);
-            else albedo = sample_face_texture(f);
+            if (render_feature::enabled<features>(render_feature::textures)) albedo = sample_face_texture(f);
+            else albedo = face_color(f);
         }
 
         glm::vec3 block_color = albedo * fac + highlight;
@@ -112,13 +115,10 @@ private:
     }
 
     static glm::vec3 sample_face_texture(fragment f) {
-        const Texture_Set *tex_set = ((int)f.triangle->block_ptr->type < 0 ||
-                                      (int)f.triangle->block_ptr->type >= std::extent<decltype(block_type::block_texture)>::value) ?
-                                      &block_type::block_texture[0] :
-                                      &block_type::block_texture[f.triangle->block_ptr->type];
-        return glm::vec3 {tex_set->sample(
+        return glm::vec3 {block_type::get_block_texture(f.triangle->block_ptr->type).sample(
             interp_tex_coord(f),
-            f.triangle->block_side_index
+            f.triangle->block_side_index,
+            f.triangle->tex_lod
         )};
     }
 };
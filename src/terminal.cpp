@@ -0,0 +1,91 @@
+#include "terminal.hpp"
+
+namespace tc {
+
+/* Set to 1 initially so that the first size query always reads the size. */
+volatile sig_atomic_t Terminal::sigwinch_received = 1;
+
+// public:
+
+int Terminal::setup_input() {
+    // equivalent of `stty -echo cbreak`
+    if (tcgetattr(STDIN_FILENO, &original_mode)) return 6;
+
+    struct termios mode = original_mode;
+    mode.c_lflag &= ~(ECHO | ICANON);
+    mode.c_cc[VMIN] = 1;
+    mode.c_cc[VTIME] = 0;
+
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &mode)) return 6;
+
+    input_set_up = true;
+    return 0;
+}
+
+int Terminal::restore_input() {
+    // equivalent of `stty echo -cbreak`, but restores exactly what was set before
+    if (!input_set_up) return 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &original_mode)) return 9;
+
+    input_set_up = false;
+    return 0;
+}
+
+int Terminal::hide_cursor() {
+    return write_escape("\e[?25l") ? 0 : 5;
+}
+
+int Terminal::show_cursor() {
+    return write_escape("\e[?25h") ? 0 : 8;
+}
+
+int Terminal::clear() {
+    return write_escape("\e[H\e[2J") ? 0 : 7;
+}
+
+int Terminal::get_size(int *X_size_ptr, int *Y_size_ptr) {
+    if (!sigwinch_installed) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = handle_sigwinch;
+        action.sa_flags = SA_RESTART; // don't interrupt the blocking input read
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGWINCH, &action, nullptr)) return 2;
+        sigwinch_installed = true;
+    }
+
+    sigwinch_received = 0;
+
+    struct winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size)) return 2;
+    if (size.ws_col == 0 || size.ws_row == 0) return 10;
+
+    *X_size_ptr = size.ws_col;
+    *Y_size_ptr = size.ws_row;
+    return 0;
+}
+
+bool Terminal::size_changed() {
+    return sigwinch_received;
+}
+
+// private:
+
+bool Terminal::write_escape(const std::string &sequence) {
+    size_t written = 0;
+    while (written < sequence.length()) {
+        ssize_t result = write(STDOUT_FILENO, sequence.data() + written, sequence.length() - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+void Terminal::handle_sigwinch(int) {
+    sigwinch_received = 1;
+}
+
+} /* end of namespace tc */
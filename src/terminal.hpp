@@ -0,0 +1,43 @@
+#ifndef TERMINAL_HPP
+#define TERMINAL_HPP
+
+#include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+namespace tc {
+
+/* Talks to the terminal directly (termios, ioctl and raw escape codes)
+ * instead of spawning tput and stty. All functions that can fail return
+ * the engine error code (see main.cpp) or 0 on success. */
+class Terminal {
+public:
+    Terminal() {}
+
+    int setup_input();
+    int restore_input();
+    int hide_cursor();
+    int show_cursor();
+    int clear();
+
+    int get_size(int *X_size_ptr, int *Y_size_ptr);
+    bool size_changed();
+
+private:
+    bool write_escape(const std::string &sequence);
+
+    static void handle_sigwinch(int);
+    static volatile sig_atomic_t sigwinch_received;
+
+    struct termios original_mode;
+    bool input_set_up = false;
+    bool sigwinch_installed = false;
+};
+
+} /* end of namespace tc */
+
+#endif /* end of include guard: TERMINAL_HPP */
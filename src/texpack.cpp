@@ -0,0 +1,59 @@
+#include "render/texture.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+/* Build step: converts png textures into the texture pack embedded in the
+ * game (see Texture_Atlas for the format), written as a c++ source file.
+ * usage: termcraft_texpack <output.cpp> <source dir> <relative png paths...> */
+
+int main(int argc, char const *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <output.cpp> <source dir> <relative png paths...>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::string> paths {argv + 3, argv + argc};
+    std::sort(paths.begin(), paths.end()); // the same pack for the same files
+
+    tc::Texture_Atlas atlas;
+    atlas.set_image_dir(argv[2]);
+    for (const std::string &path : paths) {
+        // missing textures would be packed as magenta
+        const std::string full_path = std::string {argv[2]} + "/" + path;
+        int width, height, channels;
+        if (!stbi_info(full_path.c_str(), &width, &height, &channels)) {
+            fprintf(stderr, "Error: Failed to read the texture %s\n", full_path.c_str());
+            return 1;
+        }
+        atlas.add(path);
+    }
+    const std::string pack = atlas.write_pack(paths);
+
+    FILE *file = fopen(argv[1], "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    // a string literal, compilers handle large ones much faster than initializer lists
+    fprintf(file, "// generated by termcraft_texpack, do not edit\n");
+    fprintf(file, "#include <cstddef>\n\nnamespace tc {\n\n");
+    fprintf(file, "extern const unsigned char texture_pack[];\nextern const size_t texture_pack_size;\n\n");
+    fprintf(file, "alignas(4) const unsigned char texture_pack[] =\n");
+    const size_t bytes_per_line = 32;
+    for (size_t i = 0; i < pack.size(); i += bytes_per_line) {
+        fprintf(file, "\"");
+        for (size_t j = i; j < std::min(i + bytes_per_line, pack.size()); ++j) {
+            fprintf(file, "\\x%02x", static_cast<unsigned char>(pack[j]));
+        }
+        fprintf(file, "\"\n");
+    }
+    fprintf(file, ";\nconst size_t texture_pack_size = %zu;\n\n} /* end of namespace tc */\n", pack.size());
+
+    const bool ok = fclose(file) == 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write %s\n", argv[1]);
+    return ok ? 0 : 1;
+}
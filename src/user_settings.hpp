@@ -5,6 +5,35 @@
 
 #include <string>
 
+namespace color_mode {
+    enum Color_Mode {
+        FULL,
+        COMPAT,
+        ASCII,
+        HALFBLOCK,
+        HALFBLOCK_COMPAT,
+        PALETTE256,
+    };
+
+    const char *const names[] = {"FULL", "COMPAT", "ASCII", "HALFBLOCK", "HALFBLOCK_COMPAT", "PALETTE256"};
+
+    // the setting color-mode, unknown names are FULL
+    inline Color_Mode from_name(const std::string &name) {
+        for (int mode = 0; mode <= PALETTE256; ++mode) {
+            if (name == names[mode]) return static_cast<Color_Mode>(mode);
+        }
+        return FULL;
+    }
+} /* end of namespace color_mode */
+
+namespace sink_type {
+    enum Sink_Type {
+        DISCARD,
+        PPM,
+        ANSI,
+    };
+} /* end of namespace sink_type */
+
 struct user_settings {
     bool cursor_visible;
 
@@ -17,18 +46,29 @@ struct user_settings {
     float look_sensitivity;
     bool noclip;
 
+    bool headless;
+    sink_type::Sink_Type sink;
+    std::string output;
+    int frames;
+    float duration;
+
     bool fixed_window_size;
     int width;
     int height;
 
-    std::string color_mode;
+    color_mode::Color_Mode color_mode;
+    float color_tolerance;
+    bool dither;
     bool disable_textures;
 
     glm::vec3 sky_color;
     float render_distance;
+    float min_render_scale;
     float fog;
 
     bool debug_info;
+    std::string trace;
+    std::string texture_dir;
     bool bad_normals;
     bool hide_hud;
 
@@ -1,7 +1,26 @@
 #include "block.hpp"
 
+#include "../render/texture_pack.hpp"
+#include "../user_settings.hpp"
+
 namespace tc {
 
+namespace block_type {
+    texture_handle block_texture[n_block_types];
+
+    bool load_block_textures() {
+        // png files for modding, the pack otherwise (still falling back to png files of paths it doesn't have)
+        if (!U.texture_dir.empty()) texture_registry.set_image_dir(U.texture_dir);
+        else if (!texture_registry.set_pack(texture_pack, texture_pack_size)) return false;
+
+        for (int type = 0; type < n_block_types; ++type) {
+            const char *const *paths = block_texture_paths[type];
+            block_texture[type] = texture_registry.add_set(paths[0], paths[1], paths[2]);
+        }
+        return true;
+    }
+} /* end of namespace block_type */
+
 block::block() : type(block_type::EMPTY), is_highlighted(false), sky_light(15) {}
 
 } /* end of namespace tc */
@@ -7,6 +7,7 @@
 #include "../render/texture.hpp"
 
 #include <memory>
+#include <type_traits>
 
 namespace tc {
 
@@ -39,17 +40,31 @@ namespace block_type {
         glm::vec3 {1.00f, 0.10f, 0.10f}, // FLOWER
         glm::vec3 {1.00f, 1.00f, 1.00f}, // TUX
     };
-    const Texture_Set block_texture[] {
-        {"res/tex/test.png"}, // EMPTY
+    // texture paths: side, top and bottom
+    const char *const block_texture_paths[][3] {
+        {"res/tex/test.png", "res/tex/test.png", "res/tex/test.png"}, // EMPTY
         {"res/tex/grass_side.png", "res/tex/grass_top.png", "res/tex/dirt.png"}, // GRASS
-        {"res/tex/dirt.png"}, // DIRT
-        {"res/tex/stone.png"}, // STONE
-        {"res/tex/oak_log_side.png", "res/tex/oak_log_top.png"}, // OAK_LOG
-        {"res/tex/oak_planks.png"}, // OAK_PLANKS
-        {"res/tex/oak_leaves.png"}, // OAK_LEAVES
-        {"res/tex/flower.png"}, // FLOWER
-        {"res/tex/Tux.png"}, // TUX
+        {"res/tex/dirt.png", "res/tex/dirt.png", "res/tex/dirt.png"}, // DIRT
+        {"res/tex/stone.png", "res/tex/stone.png", "res/tex/stone.png"}, // STONE
+        {"res/tex/oak_log_side.png", "res/tex/oak_log_top.png", "res/tex/oak_log_top.png"}, // OAK_LOG
+        {"res/tex/oak_planks.png", "res/tex/oak_planks.png", "res/tex/oak_planks.png"}, // OAK_PLANKS
+        {"res/tex/oak_leaves.png", "res/tex/oak_leaves.png", "res/tex/oak_leaves.png"}, // OAK_LEAVES
+        {"res/tex/flower.png", "res/tex/flower.png", "res/tex/flower.png"}, // FLOWER
+        {"res/tex/Tux.png", "res/tex/Tux.png", "res/tex/Tux.png"}, // TUX
     };
+    const int n_block_types = std::extent<decltype(block_texture_paths)>::value;
+
+    // handles in texture_registry, valid after load_block_textures
+    extern texture_handle block_texture[n_block_types];
+
+    /* adds the block textures to texture_registry, once after the options are parsed
+     * returns false if the built-in texture pack is invalid */
+    bool load_block_textures();
+
+    inline const Texture_Set &get_block_texture(Block_Type type) {
+        return texture_registry.get(block_texture[((int)type < 0 || (int)type >= n_block_types) ? 0 : type]);
+    }
+
     const bool block_transparent[] {
         true, // EMPTY
         false, // GRASS
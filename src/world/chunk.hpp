@@ -18,6 +18,10 @@ namespace chunk_size {
     const float inv_width = 1.0f / width;
     const float inv_height = 1.0f / height;
     const float inv_depth = 1.0f / depth;
+
+    // the chunk mesh is split into sections of section_height blocks for culling
+    const int section_height = 16;
+    const int n_sections = height / section_height;
 } /* end of namespace chunk_size */
 
 class Chunk {
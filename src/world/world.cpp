@@ -188,8 +188,8 @@ void World::generate_initial_mesh() {
     remesh_world();
 }
 
-mesh World::get_mesh() {
-    return world_mesh;
+std::shared_ptr<const mesh> World::get_mesh() const {
+    return std::atomic_load(&world_mesh);
 }
 
 block* World::get_block(glm::ivec3 coord) {
@@ -241,6 +241,8 @@ glm::ivec2 World::get_world_center() {
 }
 
 void World::update_chunks(glm::vec3 new_player_pos, glm::vec3 old_player_pos, float render_dist) {
+    profiler::Scoped_Timer timer {"World::update_chunks"};
+
     /* If the player moves from one chunk to another,
      * we remesh the loaded chunk difference (boolean operation). */
 
@@ -277,7 +279,7 @@ void World::update_chunks(glm::vec3 new_player_pos, glm::vec3 old_player_pos, fl
 
 size_t World::estimate_memory_usage() {
     size_t blocks_bytes = sizeof(block) * chunk_size::width * chunk_size::height * chunk_size::depth * chunks.size() * chunks[0].size();
-    size_t world_mesh_bytes = world_mesh.tri_list.capacity() * 3*sizeof(vertex);
+    size_t world_mesh_bytes = get_mesh()->tri_list.capacity() * 3*sizeof(vertex);
 
     size_t chunks_mesh_bytes = 0;
     size_t blocks_mesh_bytes = 0;
@@ -316,6 +318,8 @@ std::optional<glm::ivec2> World::get_chunk_coord_of_block(glm::ivec3 coord) {
 }
 
 void World::update_block(glm::ivec3 coord) {
+    profiler::Scoped_Timer timer {"World::update_block"};
+
     block_update_simulation(coord);
 
     // use this if ao doesn't matter
@@ -503,6 +507,8 @@ void World::remesh_block(glm::ivec3 coord) {
 }
 
 void World::remesh_chunk(glm::ivec2 coord) {
+    profiler::Scoped_Timer timer {"World::remesh_chunk"};
+
     Chunk &chunk = chunks[coord.x][coord.y];
     chunk.chunk_mesh = mesh {};
 
@@ -519,21 +525,39 @@ void World::remesh_chunk(glm::ivec2 coord) {
 
         chunk.chunk_mesh.tri_list.reserve(mesh_size);
 
-        // combining all block's meshes
-        for (int x = 0; x < chunk_size::width; ++x) {
-            for (int y = 0; y < chunk_size::height; ++y) {
-                for (int z = 0; z < chunk_size::depth; ++z) {
-                    chunk.chunk_mesh.append(
-                        chunk.blocks[x][y][z].block_mesh->transform(glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z)))
-                    );
+        // combining all block's meshes, section by section
+        for (int section = 0; section < chunk_size::n_sections; ++section) {
+            const int begin = chunk.chunk_mesh.tri_list.size();
+
+            for (int x = 0; x < chunk_size::width; ++x) {
+                for (int y = section * chunk_size::section_height; y < (section + 1) * chunk_size::section_height; ++y) {
+                    for (int z = 0; z < chunk_size::depth; ++z) {
+                        chunk.chunk_mesh.append(
+                            chunk.blocks[x][y][z].block_mesh->transform(glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z)))
+                        );
+                    }
+                }
+            }
+
+            const int end = chunk.chunk_mesh.tri_list.size();
+            if (begin == end) continue;
+
+            mesh_section s {begin, end, glm::vec3(chunk.chunk_mesh.tri_list[begin].vertices[0].pos), glm::vec3(chunk.chunk_mesh.tri_list[begin].vertices[0].pos)};
+            for (int i = begin; i < end; ++i) {
+                for (const vertex &v : chunk.chunk_mesh.tri_list[i].vertices) {
+                    s.bb_min = glm::min(s.bb_min, glm::vec3(v.pos));
+                    s.bb_max = glm::max(s.bb_max, glm::vec3(v.pos));
                 }
             }
+            chunk.chunk_mesh.sections.push_back(s);
         }
     }
 }
 
 void World::remesh_world() {
-    world_mesh = mesh {};
+    profiler::Scoped_Timer timer {"World::remesh_world"};
+
+    auto new_mesh = std::make_shared<mesh>();
 
     int mesh_size = 0;
     for (int x = 0; x < chunks.size(); ++x) {
@@ -542,15 +566,17 @@ void World::remesh_world() {
         }
     }
 
-    world_mesh.tri_list.reserve(mesh_size);
+    new_mesh->tri_list.reserve(mesh_size);
 
     for (int x = 0; x < chunks.size(); ++x) {
         for (int z = 0; z < chunks[x].size(); ++z) {
-            world_mesh.append(
+            new_mesh->append(
                 chunks[x][z].chunk_mesh.transform(glm::translate(glm::mat4(1.0f), glm::vec3(x*chunk_size::width, 0, z*chunk_size::depth)))
             );
         }
     }
+
+    std::atomic_store(&world_mesh, std::shared_ptr<const mesh> {std::move(new_mesh)});
 }
 
 } /* end of namespace tc */
@@ -9,6 +9,7 @@
 #include "../render/draw_util.hpp"
 #include "mesh_util.hpp"
 #include "spline.hpp"
+#include "../profiler.hpp"
 
 #include <cstdlib>
 #include <cstdio>
@@ -26,7 +27,7 @@ public:
     void generate(int seed, glm::ivec2 size);
     void generate_initial_mesh();
 
-    mesh get_mesh();
+    std::shared_ptr<const mesh> get_mesh() const;
     block* get_block(glm::ivec3 coord);
     void replace(glm::ivec3 coord, block_type::Block_Type type);
     void highlight_block(glm::ivec3 coord);
@@ -46,7 +47,10 @@ private:
     void remesh_world();
 
     std::vector<std::vector<Chunk>> chunks;
-    mesh world_mesh;
+    /* Published snapshot, replaced as a whole (never modified) when the
+     * world is remeshed, so the renderer can keep using an old one
+     * without copying or locking. Accessed with std::atomic_load/store. */
+    std::shared_ptr<const mesh> world_mesh = std::make_shared<const mesh>();
     block null_block; // is returned for invalid coords; Using this willy nilly is UB
     glm::ivec3 highlighted_block {-1};
 };